@@ -0,0 +1,47 @@
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+uint64_t bench_mmio_accesses = 0;
+
+uint64_t bench_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void bench_print_header(const char *title)
+{
+    printf("\n%s\n", title);
+    printf("%-44s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "mmio/op");
+}
+
+void bench_begin(bench_case_t *bench, const char *name, uint32_t iterations)
+{
+    bench->name       = name;
+    bench->iterations = iterations;
+    bench->start_mmio = bench_mmio_accesses;
+    bench->paused_ns  = 0U;
+    bench->start_ns   = bench_clock_ns();
+}
+
+void bench_end(bench_case_t *bench)
+{
+    uint64_t elapsed = bench_clock_ns() - bench->start_ns - bench->paused_ns;
+    uint64_t mmio    = bench_mmio_accesses - bench->start_mmio;
+    double   ops     = (bench->iterations > 0U) ? (double)bench->iterations : 1.0;
+
+    printf("%-44s %12u %10.1f %10.2f\n", bench->name, (unsigned)bench->iterations,
+        (double)elapsed / ops, (double)mmio / ops);
+}
+
+void bench_pause(bench_case_t *bench)
+{
+    bench->pause_start_ns = bench_clock_ns();
+}
+
+void bench_resume(bench_case_t *bench)
+{
+    bench->paused_ns += bench_clock_ns() - bench->pause_start_ns;
+}
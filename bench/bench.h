@@ -0,0 +1,88 @@
+#ifndef DMGPIO_BENCH_H
+#define DMGPIO_BENCH_H
+
+#include <stdint.h>
+#include "dmgpio_types.h"
+
+/**
+ * @brief Number of register accesses performed so far by the mocked port layer.
+ *
+ * Incremented by bench/mock_port.c for every simulated MMIO read or write.
+ * Benchmarks that run against a real port leave it at zero.
+ */
+extern uint64_t bench_mmio_accesses;
+
+/**
+ * @brief Call the handlers registered with the mocked port layer for @p pins
+ *        of @p port, as the EXTI ISR would (bench/mock_port.c).
+ */
+void bench_mock_raise_interrupt(dmgpio_port_t port, dmgpio_pins_mask_t pins);
+
+/**
+ * @brief Wire the output data register of @p port to its input data
+ *        register, as if every pin were looped back externally.
+ *
+ * @return The output data register.
+ */
+uint32_t bench_mock_loop_back(dmgpio_port_t port);
+
+/**
+ * @brief State of a single running benchmark case.
+ */
+typedef struct
+{
+    const char *name;           /**< Case name printed in the report */
+    uint32_t    iterations;     /**< Number of operations measured */
+    uint64_t    start_ns;       /**< Monotonic clock at bench_begin() */
+    uint64_t    start_mmio;     /**< bench_mmio_accesses at bench_begin() */
+    uint64_t    paused_ns;      /**< Time spent between bench_pause() and bench_resume() */
+    uint64_t    pause_start_ns; /**< Monotonic clock at the last bench_pause() */
+} bench_case_t;
+
+/**
+ * @brief Return a monotonic timestamp in nanoseconds.
+ */
+uint64_t bench_clock_ns(void);
+
+/**
+ * @brief Print the report header.
+ */
+void bench_print_header(const char *title);
+
+/**
+ * @brief Start measuring a case of @p iterations operations.
+ */
+void bench_begin(bench_case_t *bench, const char *name, uint32_t iterations);
+
+/**
+ * @brief Stop measuring and print ns/op and MMIO accesses per op.
+ */
+void bench_end(bench_case_t *bench);
+
+/**
+ * @brief Exclude the time until bench_resume() from the case (e.g. housekeeping
+ *        that keeps the measured operation in a steady state).
+ */
+void bench_pause(bench_case_t *bench);
+
+/**
+ * @brief Continue measuring after bench_pause().
+ */
+void bench_resume(bench_case_t *bench);
+
+/**
+ * @brief Run @p body @p iterations times and report it as case @p name.
+ */
+#define BENCH_LOOP(name, iterations, body)                          \
+    do                                                              \
+    {                                                               \
+        bench_case_t bench_case_;                                   \
+        bench_begin(&bench_case_, (name), (iterations));            \
+        for (uint32_t bench_i_ = 0; bench_i_ < (iterations); bench_i_++) \
+        {                                                           \
+            body;                                                   \
+        }                                                           \
+        bench_end(&bench_case_);                                    \
+    } while (0)
+
+#endif // DMGPIO_BENCH_H
@@ -0,0 +1,792 @@
+/*
+ * Micro-benchmarks of the dmdrvi front-end (src/dmgpio.c).
+ *
+ * The driver source is included directly so that static helpers such as
+ * configure() can be measured in isolation.  The port layer is replaced by
+ * bench/mock_port.c, which counts the register accesses of every operation.
+ */
+#include "../src/dmgpio.c"
+#include "dmgpio_pwm.h"
+#include "bench.h"
+#include "dmgpio_board_nucleo_f767zi.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef DMGPIO_BENCH_BOARD_INI
+#define DMGPIO_BENCH_BOARD_INI  "configs/board/nucleo-f767zi.ini"
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS    100000U
+
+/** Sections in the generated large board INI; only the last one is a GPIO device. */
+#define BENCH_LARGE_INI_SECTIONS    200U
+
+/** Devices of the generated bring-up board: one output per pin of ports D and E. */
+#define BENCH_BOARD_DEVICES         32U
+
+/** Software PWM channels: one per pin 0-7 of ports D, E and F. */
+#define BENCH_PWM_CHANNELS          24U
+#define BENCH_PWM_PERIOD            256U
+
+/** Operations per dmgpio_ioctl_cmd_run_batch call: set, reset, toggle, read repeated */
+#define BENCH_BATCH_OPS             64U
+
+static const char s_output_ini[] =
+    "[dmgpio]\n"
+    "pin=PB1\n"
+    "mode=output\n"
+    "speed=minimum\n"
+    "output_circuit=push_pull\n";
+
+static const char s_button_ini[] =
+    "[dmgpio]\n"
+    "pin=PC13\n"
+    "mode=input\n"
+    "interrupt_trigger=both_edges\n"
+    "interrupt_stats=1\n";
+
+static const char s_diagnostics_ini[] =
+    "[gpio_diag]\n"
+    "diagnostics=1\n";
+
+/** 8-bit bus on scattered, unordered pins of port G */
+static const char s_bus_ini[] =
+    "[data_bus]\n"
+    "bus=PG0,PG1,PG5,PG7,PG2,PG12,PG14,PG15\n"
+    "mode=output\n";
+
+/** 24-bit bus crossing ports D, E and F */
+static const char s_wide_bus_ini[] =
+    "[wide_bus]\n"
+    "bus=PD3,PD0,PD9,PD1,PD12,PD5,PD14,PD7,PE2,PE8,PE0,PE11,PE4,PE15,PE6,PE1,"
+    "PF10,PF3,PF0,PF13,PF5,PF2,PF7,PF9\n"
+    "mode=output\n";
+
+static void bench_interrupt_handler(dmdrvi_context_t context, dmgpio_port_t port,
+                                    dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    (void)context; (void)port; (void)pins; (void)state;
+}
+
+static dmini_context_t load_ini_string(const char *str)
+{
+    dmini_context_t ini = dmini_create();
+    if (ini != NULL && dmini_parse_string(ini, str) != 0)
+    {
+        dmini_destroy(ini);
+        return NULL;
+    }
+    return ini;
+}
+
+/**
+ * @brief Build a board INI with BENCH_LARGE_INI_SECTIONS sections: other
+ *        peripherals first and the GPIO device last, the worst case for
+ *        finding the device section.
+ */
+static dmini_context_t load_large_ini(void)
+{
+    dmini_context_t ini = dmini_create();
+    if (ini == NULL) return NULL;
+    char section[32];
+    char value[16];
+    for (uint32_t i = 0; i < BENCH_LARGE_INI_SECTIONS - 1U; i++)
+    {
+        snprintf(section, sizeof(section), "uart_%u", (unsigned)i);
+        snprintf(value, sizeof(value), "%u", (unsigned)(i % 8U));
+        dmini_set_string(ini, section, "instance", value);
+        dmini_set_string(ini, section, "baudrate", "115200");
+        dmini_set_string(ini, section, "driver_name", "dmuart");
+    }
+    dmini_set_string(ini, "led_last", "pin", "PD15");
+    dmini_set_string(ini, "led_last", "mode", "output");
+    dmini_set_string(ini, "led_last", "driver_name", "dmgpio");
+    return ini;
+}
+
+static dmini_context_t load_ini_file(const char *path)
+{
+    dmini_context_t ini = dmini_create();
+    if (ini != NULL && dmini_parse_file(ini, path) != 0)
+    {
+        dmini_destroy(ini);
+        return NULL;
+    }
+    return ini;
+}
+
+static void bench_read_write(dmdrvi_context_t ctx, void *handle, uint32_t iterations)
+{
+    char buffer[16];
+    static const char value[] = "0x0001\n";
+
+    BENCH_LOOP("read (\"0x%04X\" text)", iterations,
+        dmgpio_dmdrvi_read(ctx, handle, buffer, sizeof(buffer), 0));
+    BENCH_LOOP("write (\"0x0001\\n\" text)", iterations,
+        dmgpio_dmdrvi_write(ctx, handle, value, sizeof(value) - 1U, 0));
+
+    static const uint8_t raw_value[2] = { 0x01, 0x00 };
+    dmgpio_data_format_t format = dmgpio_data_format_raw;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+    BENCH_LOOP("read (raw)", iterations,
+        dmgpio_dmdrvi_read(ctx, handle, buffer, sizeof(buffer), 0));
+    BENCH_LOOP("write (raw)", iterations,
+        dmgpio_dmdrvi_write(ctx, handle, raw_value, sizeof(raw_value), 0));
+    format = dmgpio_data_format_text;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+}
+
+static void bench_ioctl(dmdrvi_context_t ctx, void *handle, uint32_t iterations)
+{
+    dmgpio_pins_state_t state = dmgpio_pins_state_all_high;
+    dmgpio_pins_mask_t  mask  = 0;
+    dmgpio_interrupt_handler_t handler = bench_interrupt_handler;
+
+    BENCH_LOOP("ioctl toggle_pins", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_toggle_pins, NULL));
+    BENCH_LOOP("ioctl set_pins_state", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_pins_state, &state));
+    BENCH_LOOP("ioctl get_high_pins_state", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_high_pins_state, &mask));
+    BENCH_LOOP("ioctl get_low_pins_state", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_low_pins_state, &mask));
+    dmgpio_data_format_t format = dmgpio_data_format_text;
+    BENCH_LOOP("ioctl set_data_format", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format));
+    BENCH_LOOP("ioctl get_data_format", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_data_format, &format));
+    dmgpio_direct_access_t access;
+    BENCH_LOOP("ioctl get_direct_access", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_direct_access, &access));
+    /* The store bypasses the mock, so account for it by hand. */
+    BENCH_LOOP("direct access set_reset store", iterations,
+        *access.set_reset = (bench_i_ & 1U) ? access.set_word : access.reset_word;
+        bench_mmio_accesses++);
+    /* Each registration is removed again so the mock's handler table never fills up. */
+    BENCH_LOOP("ioctl set_interrupt_handler (+remove)", iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_interrupt_handler, &handler);
+        dmgpio_port_remove_interrupt_handler(ctx->config.port, ctx));
+}
+
+/**
+ * @brief Run the operations of @p ops with one ioctl each, storing the
+ *        results of the reads like dmgpio_ioctl_cmd_run_batch.
+ */
+static void run_single_ioctls(dmdrvi_context_t ctx, void *handle, dmgpio_batch_op_t *ops, uint32_t count)
+{
+    dmgpio_pins_state_t high = dmgpio_pins_state_all_high;
+    dmgpio_pins_state_t low  = dmgpio_pins_state_all_low;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        dmgpio_pins_mask_t mask = 0;
+        switch (ops[i].op)
+        {
+            case dmgpio_batch_op_set:
+                dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_pins_state, &high);
+                break;
+            case dmgpio_batch_op_reset:
+                dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_pins_state, &low);
+                break;
+            case dmgpio_batch_op_toggle:
+                dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_toggle_pins, NULL);
+                break;
+            default:
+                dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_high_pins_state, &mask);
+                ops[i].value = mask;
+                break;
+        }
+    }
+}
+
+static void bench_batch(dmdrvi_context_t ctx, void *handle, uint32_t iterations)
+{
+    static const dmgpio_batch_op_code_t pattern[4] = {
+        dmgpio_batch_op_set, dmgpio_batch_op_reset, dmgpio_batch_op_toggle, dmgpio_batch_op_read };
+    dmgpio_batch_op_t ops[BENCH_BATCH_OPS];
+    dmgpio_batch_t    batch = { ops, BENCH_BATCH_OPS };
+    for (uint32_t i = 0; i < BENCH_BATCH_OPS; i++)
+    {
+        ops[i].op    = pattern[i % 4U];
+        ops[i].value = ctx->config.pins;
+    }
+
+    uint32_t batches = (iterations / BENCH_BATCH_OPS != 0U) ? iterations / BENCH_BATCH_OPS : 1U;
+    BENCH_LOOP("64 single ioctls (set/reset/toggle/read)", batches,
+        run_single_ioctls(ctx, handle, ops, BENCH_BATCH_OPS));
+    BENCH_LOOP("ioctl run_batch (64 ops)", batches,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_run_batch, &batch));
+
+    /* Same sequence both ways from the same state: same output, same reads */
+    dmgpio_batch_op_t single_ops[BENCH_BATCH_OPS];
+    memcpy(single_ops, ops, sizeof(ops));
+    dmgpio_port_write_data(ctx->config.port, ctx->config.pins, 0U);
+    bench_mock_loop_back(ctx->config.port);
+    run_single_ioctls(ctx, handle, single_ops, BENCH_BATCH_OPS);
+    uint32_t single_output = bench_mock_loop_back(ctx->config.port);
+    dmgpio_port_write_data(ctx->config.port, ctx->config.pins, 0U);
+    bench_mock_loop_back(ctx->config.port);
+    int ret = dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_run_batch, &batch);
+    uint32_t batch_output = bench_mock_loop_back(ctx->config.port);
+    if (ret != 0 || batch_output != single_output || memcmp(ops, single_ops, sizeof(ops)) != 0)
+        printf("  ERROR: run_batch returned %d, output 0x%04X (single ioctls: 0x%04X)\n",
+            ret, (unsigned)batch_output, (unsigned)single_output);
+
+    dmgpio_batch_op_t invalid[2] = { { dmgpio_batch_op_set, ctx->config.pins }, { (dmgpio_batch_op_code_t)42, 0U } };
+    dmgpio_batch_t    invalid_batch = { invalid, 2U };
+    dmgpio_port_write_data(ctx->config.port, ctx->config.pins, 0U);
+    if (dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_run_batch, &invalid_batch) != -EINVAL ||
+        (bench_mock_loop_back(ctx->config.port) & ctx->config.pins) != 0U)
+        printf("  ERROR: run_batch ran part of an invalid batch\n");
+}
+
+static void bench_event_queue(dmini_context_t button_ini, uint32_t iterations)
+{
+    dmdrvi_context_t ctx = dmgpio_dmdrvi_create(button_ini, NULL);
+    if (ctx == NULL)
+    {
+        printf("%-44s skipped (cannot create the button device)\n", "event queue");
+        return;
+    }
+    void *handle = dmgpio_dmdrvi_open(ctx, DMDRVI_O_RDONLY);
+    dmgpio_data_format_t format = dmgpio_data_format_events;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+
+    dmgpio_event_t events[8];
+    size_t read_bytes = 0;
+    BENCH_LOOP("interrupt -> event queue -> read", iterations,
+        bench_mock_raise_interrupt(ctx->config.port, ctx->config.pins);
+        read_bytes += dmgpio_dmdrvi_read(ctx, handle, events, sizeof(events), 0));
+    BENCH_LOOP("read (events, empty, non-blocking)", iterations,
+        read_bytes += dmgpio_dmdrvi_read(ctx, handle, events, sizeof(events), 0));
+
+    uint32_t overflows = 0;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_event_overflows, &overflows);
+    if (read_bytes != iterations * sizeof(dmgpio_event_t) || overflows != 0U)
+        printf("  ERROR: read %u of %u events, %u overflows\n",
+            (unsigned)(read_bytes / sizeof(dmgpio_event_t)), (unsigned)iterations, (unsigned)overflows);
+
+    /* The mock's cycle counter is the monotonic clock, so latencies are in ns. */
+    dmgpio_device_stats_t stats;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_get_stats, &stats);
+    if (stats.interrupts != iterations || stats.reads != 2U * iterations || stats.interrupts_dropped != 0U)
+        printf("  ERROR: stats report %u interrupts, %u reads, %u dropped\n",
+            (unsigned)stats.interrupts, (unsigned)stats.reads, (unsigned)stats.interrupts_dropped);
+    uint32_t median = 0U;
+    for (uint32_t seen = 0U; median < DMGPIO_LATENCY_BUCKETS; median++)
+    {
+        seen += stats.latency[median];
+        if (2U * seen >= stats.interrupts)
+            break;
+    }
+    printf("  ISR entry to handler: median < %lu ns, max %u ns\n",
+        1UL << (median + 1U), (unsigned)stats.latency_max);
+
+    dmgpio_dmdrvi_close(ctx, handle);
+    dmgpio_dmdrvi_free(ctx);
+}
+
+/**
+ * @brief Read the diagnostics device in small chunks, as cat would.
+ *
+ * @return Length of the dump.
+ */
+static size_t read_dump(dmdrvi_context_t diag, void *handle, char *text, size_t capacity)
+{
+    size_t length = 0;
+    size_t chunk;
+    while (length < capacity &&
+           (chunk = dmgpio_dmdrvi_read(diag, handle, text + length,
+                (capacity - length < 64U) ? capacity - length : 64U, (uint32_t)length)) > 0U)
+        length += chunk;
+    return length;
+}
+
+static void bench_diagnostics(dmini_context_t button_ini, uint32_t iterations)
+{
+    dmini_context_t  diag_ini = load_ini_string(s_diagnostics_ini);
+    dmdrvi_dev_num_t dev_num;
+    memset(&dev_num, 0, sizeof(dev_num));
+    dmdrvi_context_t button = dmgpio_dmdrvi_create(button_ini, NULL);
+    dmdrvi_context_t diag   = (diag_ini != NULL) ? dmgpio_dmdrvi_create(diag_ini, &dev_num) : NULL;
+    if (button == NULL || diag == NULL)
+    {
+        printf("%-44s skipped (cannot create the devices)\n", "diagnostics");
+        dmgpio_dmdrvi_free(button);
+        dmgpio_dmdrvi_free(diag);
+        if (diag_ini != NULL) dmini_destroy(diag_ini);
+        return;
+    }
+    void *handle = dmgpio_dmdrvi_open(diag, DMDRVI_O_RDONLY);
+    static dmgpio_diagnostics_t before;
+    static dmgpio_diagnostics_t after;
+    dmgpio_dmdrvi_ioctl(diag, handle, dmgpio_ioctl_cmd_get_diagnostics, &before);
+    for (uint32_t i = 0; i < 3U; i++)
+        bench_mock_raise_interrupt(button->config.port, button->config.pins);
+    dmgpio_dmdrvi_ioctl(diag, handle, dmgpio_ioctl_cmd_get_diagnostics, &after);
+
+    static char text[DMGPIO_DIAG_TEXT_SIZE + 1U];
+    size_t length = 0;
+    BENCH_LOOP("read diagnostics dump (64-byte chunks)", iterations,
+        length = read_dump(diag, handle, text, DMGPIO_DIAG_TEXT_SIZE));
+    text[length] = '\0';
+
+    if (strstr(text, "PC used=0x2000\n") == NULL || strstr(text, "PC handler pins=0x2000") == NULL ||
+        strstr(text, "EXTI13 port=PC imr=1 rtsr=1 ftsr=1 interrupts=") == NULL ||
+        after.line_interrupts[13] - before.line_interrupts[13] != 3U ||
+        strcmp(dev_num.alt_name, "gpio_diag") != 0 || dmgpio_dmdrvi_write(diag, handle, "1", 1U, 0) != 0)
+        printf("  ERROR: unexpected diagnostics device or dump:\n%s", text);
+
+    dmgpio_dmdrvi_close(diag, handle);
+    dmgpio_dmdrvi_free(diag);
+    dmgpio_dmdrvi_free(button);
+    dmini_destroy(diag_ini);
+}
+
+/**
+ * @brief Drive the bus pins of @p ctx one at a time, as an application
+ *        built on single-pin devices would.
+ */
+static void write_bus_per_pin(dmdrvi_context_t ctx, uint32_t value)
+{
+    for (uint32_t bit = 0; bit < ctx->config.bus_width; bit++)
+    {
+        dmgpio_port_t      port = (dmgpio_port_t)(ctx->config.bus_pins[bit] >> 4U);
+        dmgpio_pins_mask_t pin  = (dmgpio_pins_mask_t)(1U << (ctx->config.bus_pins[bit] & 0x0FU));
+        dmgpio_port_write_data(port, pin, ((value >> bit) & 1U) ? pin : 0U);
+    }
+}
+
+/**
+ * @brief Write @p value to a bus device, loop the pins back and read it.
+ *
+ * @return 0 if every pin was driven as bus_pins says and the value read
+ *         back is @p value.
+ */
+static int check_bus_round_trip(dmdrvi_context_t ctx, void *handle, uint32_t value)
+{
+    const dmgpio_bus_map_t *bus = ctx->bus;
+    size_t   raw_size = is_wide(ctx) ? DMGPIO_WIDE_RAW_DATA_SIZE : DMGPIO_RAW_DATA_SIZE;
+    uint8_t  raw[DMGPIO_WIDE_RAW_DATA_SIZE];
+    for (size_t i = 0; i < raw_size; i++)
+        raw[i] = (uint8_t)(value >> (8U * i));
+    dmgpio_dmdrvi_write(ctx, handle, raw, raw_size, 0);
+
+    int errors = 0;
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+    {
+        uint32_t expected = 0U;
+        for (uint32_t bit = 0; bit < ctx->config.bus_width; bit++)
+            if ((ctx->config.bus_pins[bit] >> 4U) == bus->ports[slot] && ((value >> bit) & 1U))
+                expected |= 1U << (ctx->config.bus_pins[bit] & 0x0FU);
+        errors |= ((bench_mock_loop_back(bus->ports[slot]) & bus->pins[slot]) != expected);
+    }
+
+    memset(raw, 0xFF, sizeof(raw));
+    dmgpio_dmdrvi_read(ctx, handle, raw, raw_size, 0);
+    uint32_t read = 0U;
+    for (size_t i = 0; i < raw_size; i++)
+        read |= (uint32_t)raw[i] << (8U * i);
+    return errors || read != value;
+}
+
+/**
+ * @brief Create a bus device through dmgpio_create_all and check that the
+ *        pins on every port it spans, not only the first, are outputs.
+ */
+static void check_create_all_bus(dmini_context_t bus_ini, const dmgpio_bus_map_t *bus)
+{
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+        dmgpio_port_set_mode(bus->ports[slot], bus->pins[slot], dmgpio_mode_input);
+
+    dmdrvi_context_t ctx = NULL;
+    if (dmgpio_create_all(bus_ini, &ctx, NULL, 1U) != 1)
+    {
+        printf("  ERROR: dmgpio_create_all did not create the bus device\n");
+        return;
+    }
+    uint32_t unconfigured = 0U;
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+    {
+        for (dmgpio_pins_mask_t pins = bus->pins[slot]; pins != 0U; pins &= (dmgpio_pins_mask_t)(pins - 1U))
+        {
+            dmgpio_mode_t mode = dmgpio_mode_default;
+            dmgpio_port_read_mode(bus->ports[slot], (dmgpio_pins_mask_t)(pins & -pins), &mode);
+            unconfigured += (mode != dmgpio_mode_output);
+        }
+    }
+    if (unconfigured != 0U)
+        printf("  ERROR: dmgpio_create_all left %u bus pins unconfigured\n", (unsigned)unconfigured);
+    dmgpio_dmdrvi_free(ctx);
+}
+
+static void bench_bus(const char *ini_str, uint32_t iterations)
+{
+    dmini_context_t  bus_ini = load_ini_string(ini_str);
+    dmdrvi_context_t ctx     = (bus_ini != NULL) ? dmgpio_dmdrvi_create(bus_ini, NULL) : NULL;
+    if (ctx == NULL)
+    {
+        printf("%-44s skipped (cannot create the bus device)\n", "bus");
+        if (bus_ini != NULL) dmini_destroy(bus_ini);
+        return;
+    }
+    void *handle = dmgpio_dmdrvi_open(ctx, DMDRVI_O_RDWR);
+    dmgpio_data_format_t format = dmgpio_data_format_raw;
+    dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+
+    uint32_t width = ctx->config.bus_width;
+    uint32_t mask  = (width == 32U) ? 0xFFFFFFFFUL : (1UL << width) - 1U;
+    size_t   raw_size = is_wide(ctx) ? DMGPIO_WIDE_RAW_DATA_SIZE : DMGPIO_RAW_DATA_SIZE;
+    uint8_t  raw[DMGPIO_WIDE_RAW_DATA_SIZE] = { 0U };
+    char     label[4][48];
+    snprintf(label[0], sizeof(label[0]), "write %u-bit bus, %u port(s) (raw)",
+        (unsigned)width, (unsigned)ctx->bus->port_count);
+    snprintf(label[1], sizeof(label[1]), "write %u-bit bus, one store per pin", (unsigned)width);
+    snprintf(label[2], sizeof(label[2]), "read %u-bit bus, %u port(s) (raw)",
+        (unsigned)width, (unsigned)ctx->bus->port_count);
+    snprintf(label[3], sizeof(label[3]), "ioctl set_bus_direction (%u port(s))",
+        (unsigned)ctx->bus->port_count);
+
+    BENCH_LOOP(label[0], iterations,
+        raw[0] = (uint8_t)bench_i_;
+        raw[2] = (uint8_t)(bench_i_ >> 8U);
+        dmgpio_dmdrvi_write(ctx, handle, raw, raw_size, 0));
+    BENCH_LOOP(label[1], iterations,
+        write_bus_per_pin(ctx, bench_i_ & mask));
+    BENCH_LOOP(label[2], iterations,
+        dmgpio_dmdrvi_read(ctx, handle, raw, raw_size, 0));
+
+    dmgpio_mode_t modes[2] = { dmgpio_mode_input, dmgpio_mode_output };
+    BENCH_LOOP(label[3], iterations,
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_bus_direction, &modes[bench_i_ & 1U]));
+
+    /* Every value of a narrow bus, a spread of values on a wide one */
+    uint32_t values = (width <= 12U) ? (1UL << width) : 4096U;
+    for (uint32_t i = 0; i < values; i++)
+    {
+        uint32_t value = (width <= 12U) ? i : (i * 2654435761UL) & mask;
+        if (check_bus_round_trip(ctx, handle, value) != 0)
+        {
+            printf("  ERROR: %u-bit bus value 0x%08X did not round-trip\n", (unsigned)width, (unsigned)value);
+            break;
+        }
+    }
+    if (is_wide(ctx))
+    {
+        /* A text read of a wide bus written back as text */
+        char text[DMGPIO_WIDE_STATE_STR_LEN + 1];
+        uint32_t value = 0xA5C3E1UL & mask;
+        format = dmgpio_data_format_text;
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+        snprintf(text, sizeof(text), "0x%08lX", (unsigned long)value);
+        size_t written = dmgpio_dmdrvi_write(ctx, handle, text, strlen(text), 0);
+        for (size_t slot = 0; slot < ctx->bus->port_count; slot++)
+            bench_mock_loop_back(ctx->bus->ports[slot]);
+        memset(text, 0, sizeof(text));
+        dmgpio_dmdrvi_read(ctx, handle, text, DMGPIO_WIDE_STATE_STR_LEN, 0);
+        if (written == 0U || strtoul(text, NULL, 16) != value)
+            printf("  ERROR: text write of 0x%08X to the %u-bit bus read back as '%s'\n",
+                (unsigned)value, (unsigned)width, text);
+        format = dmgpio_data_format_raw;
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_data_format, &format);
+    }
+
+    dmgpio_mode_t alternate = dmgpio_mode_alternate;
+    if (dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_set_bus_direction, &alternate) != -EINVAL)
+        printf("  ERROR: set_bus_direction accepted an invalid mode\n");
+    if (ctx->bus->port_count > 1U &&
+        dmgpio_dmdrvi_ioctl(ctx, handle, dmgpio_ioctl_cmd_toggle_pins, NULL) != -EINVAL)
+        printf("  ERROR: a bus spanning several ports accepted a pin mask ioctl\n");
+
+    dmgpio_bus_map_t bus = *ctx->bus;
+    dmgpio_dmdrvi_close(ctx, handle);
+    dmgpio_dmdrvi_free(ctx);
+    check_create_all_bus(bus_ini, &bus);
+    dmini_destroy(bus_ini);
+}
+
+/**
+ * @brief Configure all 16 pins of the context's port one device at a time,
+ *        flipping their mode on every round so each round changes MODER.
+ */
+static void configure_port_pins(dmdrvi_context_t ctx, uint32_t round)
+{
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        ctx->config.pins = (dmgpio_pins_mask_t)(1U << pin);
+        ctx->config.mode = (round & 1U) ? dmgpio_mode_output : dmgpio_mode_input;
+        configure(ctx);
+    }
+}
+
+static void bench_configuration(dmdrvi_context_t ctx, dmini_context_t board, uint32_t iterations)
+{
+    BENCH_LOOP("configure()", iterations,
+        configure(ctx));
+
+    /* A board bring-up: 16 single-pin devices on one port.  In one outer
+     * session every configuration register is read and written once. */
+    const dmgpio_config_t saved = ctx->config;
+    uint32_t rounds = iterations / 16U + 1U;
+    BENCH_LOOP("configure() x16 pins, separate sessions", rounds,
+        configure_port_pins(ctx, bench_i_));
+    BENCH_LOOP("configure() x16 pins, one session", rounds,
+        dmgpio_port_begin_configuration(saved.port, 0xFFFFU);
+        configure_port_pins(ctx, bench_i_);
+        dmgpio_port_finish_configuration(saved.port, 0xFFFFU));
+    ctx->config = saved;
+    configure(ctx);
+
+    if (board == NULL)
+    {
+        printf("%-44s skipped (cannot load %s)\n", "create+free (board INI)", DMGPIO_BENCH_BOARD_INI);
+        return;
+    }
+    dmdrvi_dev_num_t dev_num;
+    BENCH_LOOP("create+free (board INI)", iterations,
+        memset(&dev_num, 0, sizeof(dev_num));
+        dmgpio_dmdrvi_free(dmgpio_dmdrvi_create(board, &dev_num)));
+}
+
+/**
+ * @brief Add the GPIO section of bring-up device @p index to @p ini.
+ */
+static void add_board_device(dmini_context_t ini, uint32_t index, int lazy)
+{
+    char section[16];
+    char pin[8];
+    snprintf(section, sizeof(section), "out_%u", (unsigned)index);
+    snprintf(pin, sizeof(pin), "P%c%u", (index < 16U) ? 'D' : 'E', (unsigned)(index % 16U));
+    dmini_set_string(ini, section, "pin", pin);
+    dmini_set_string(ini, section, "mode", "output");
+    dmini_set_string(ini, section, "speed", "medium");
+    dmini_set_string(ini, section, "output_circuit", "push_pull");
+    dmini_set_string(ini, section, "driver_name", "dmgpio");
+    if (lazy)
+        dmini_set_string(ini, section, "lazy", "1");
+}
+
+/**
+ * @brief Board bring-up: one _create per device versus dmgpio_create_all,
+ *        and dmgpio_create_all with every device lazy.
+ */
+static void bench_board_bring_up(uint32_t iterations)
+{
+    dmini_context_t board      = dmini_create();
+    dmini_context_t lazy_board = dmini_create();
+    dmini_context_t single[BENCH_BOARD_DEVICES];
+    for (uint32_t i = 0; i < BENCH_BOARD_DEVICES; i++)
+    {
+        single[i] = dmini_create();
+        add_board_device(single[i], i, 0);
+        add_board_device(board, i, 0);
+        add_board_device(lazy_board, i, 1);
+    }
+
+    dmdrvi_context_t contexts[BENCH_BOARD_DEVICES];
+    dmdrvi_dev_num_t dev_nums[BENCH_BOARD_DEVICES];
+    uint32_t rounds = iterations / 100U + 1U;
+    BENCH_LOOP("bring-up 32 devices, _create each", rounds,
+        for (uint32_t i = 0; i < BENCH_BOARD_DEVICES; i++)
+            contexts[i] = dmgpio_dmdrvi_create(single[i], &dev_nums[i]);
+        for (uint32_t i = 0; i < BENCH_BOARD_DEVICES; i++)
+            dmgpio_dmdrvi_free(contexts[i]));
+
+    int created = 0;
+    BENCH_LOOP("bring-up 32 devices, dmgpio_create_all", rounds,
+        created = dmgpio_create_all(board, contexts, dev_nums, BENCH_BOARD_DEVICES);
+        for (int i = 0; i < created; i++)
+            dmgpio_dmdrvi_free(contexts[i]));
+    if (created != (int)BENCH_BOARD_DEVICES)
+        printf("  ERROR: dmgpio_create_all created %d of %u devices\n", created, (unsigned)BENCH_BOARD_DEVICES);
+
+    /* Nothing but the first device is touched after boot */
+    BENCH_LOOP("bring-up 32 devices lazy=1, 1 opened", rounds,
+        created = dmgpio_create_all(lazy_board, contexts, dev_nums, BENCH_BOARD_DEVICES);
+        dmgpio_dmdrvi_close(contexts[0], dmgpio_dmdrvi_open(contexts[0], DMDRVI_O_RDWR));
+        for (int i = 0; i < created; i++)
+            dmgpio_dmdrvi_free(contexts[i]));
+    if (created != (int)BENCH_BOARD_DEVICES)
+        printf("  ERROR: lazy dmgpio_create_all created %d of %u devices\n", created, (unsigned)BENCH_BOARD_DEVICES);
+
+    for (uint32_t i = 0; i < BENCH_BOARD_DEVICES; i++)
+        dmini_destroy(single[i]);
+    dmini_destroy(lazy_board);
+    dmini_destroy(board);
+}
+
+/**
+ * @brief Cold boot of the bench board: dmgpio_create_all on the INI file
+ *        against dmgpio_create_from_board on its table generated at build
+ *        time.
+ */
+static void bench_board_table(dmini_context_t board_ini, uint32_t iterations)
+{
+    const dmgpio_board_t *board = &dmgpio_board_nucleo_f767zi;
+    dmdrvi_context_t contexts[BENCH_BOARD_DEVICES];
+    dmdrvi_dev_num_t dev_nums[BENCH_BOARD_DEVICES];
+    uint32_t rounds = iterations / 10U + 1U;
+    int created = 0;
+
+    if (board_ini != NULL)
+    {
+        BENCH_LOOP("bring-up board, dmgpio_create_all (INI)", rounds,
+            created = dmgpio_create_all(board_ini, contexts, dev_nums, BENCH_BOARD_DEVICES);
+            for (int i = 0; i < created; i++)
+                dmgpio_dmdrvi_free(contexts[i]));
+    }
+
+    BENCH_LOOP("bring-up board, dmgpio_create_from_board", rounds,
+        created = dmgpio_create_from_board(board, contexts, dev_nums, BENCH_BOARD_DEVICES);
+        for (int i = 0; i < created; i++)
+            dmgpio_dmdrvi_free(contexts[i]));
+    if (created != (int)board->device_count)
+        printf("  ERROR: dmgpio_create_from_board created %d of %u devices\n",
+            created, (unsigned)board->device_count);
+}
+
+static void bench_large_board(uint32_t iterations)
+{
+    dmini_context_t ini = load_large_ini();
+    if (ini == NULL)
+    {
+        printf("%-44s skipped (cannot build the INI)\n", "create+free (200-section INI)");
+        return;
+    }
+    dmdrvi_dev_num_t dev_num;
+    uint32_t named = 0;
+    uint32_t count = iterations / 100U + 1U;
+    BENCH_LOOP("create+free (200-section INI)", count,
+        memset(&dev_num, 0, sizeof(dev_num));
+        dmgpio_dmdrvi_free(dmgpio_dmdrvi_create(ini, &dev_num));
+        named += (dev_num.flags & DMDRVI_NUM_ALT_NAME) && strcmp(dev_num.alt_name, "led_last") == 0);
+    if (named != count)
+        printf("  ERROR: %u of %u devices named 'led_last'\n", (unsigned)named, (unsigned)count);
+    dmini_destroy(ini);
+}
+
+/**
+ * @brief Per-tick cost of the software PWM engine against a loop that writes
+ *        every channel on every tick, and check of the high time of every
+ *        channel over one period.
+ */
+static void bench_pwm_engine(uint32_t iterations)
+{
+    dmgpio_pwm_t pwm = dmgpio_pwm_create(BENCH_PWM_PERIOD);
+    if (pwm == NULL)
+    {
+        printf("%-44s skipped (cannot create the engine)\n", "pwm tick");
+        return;
+    }
+
+    dmgpio_port_t      ports[BENCH_PWM_CHANNELS];
+    dmgpio_pins_mask_t pins[BENCH_PWM_CHANNELS];
+    uint32_t           duties[BENCH_PWM_CHANNELS];
+    for (uint32_t i = 0; i < BENCH_PWM_CHANNELS; i++)
+    {
+        ports[i]  = (dmgpio_port_t)(3U + i / 8U);
+        pins[i]   = (dmgpio_pins_mask_t)(1U << (i % 8U));
+        duties[i] = i * 10U + 5U;
+        if (dmgpio_pwm_add_channel(pwm, ports[i], pins[i], duties[i]) != (int)i)
+            printf("  ERROR: cannot add PWM channel %u\n", (unsigned)i);
+    }
+
+    uint32_t ticks = (iterations / BENCH_PWM_PERIOD + 1U) * BENCH_PWM_PERIOD;
+    BENCH_LOOP("pwm tick, 24 channels on 3 ports", ticks,
+        dmgpio_pwm_tick(pwm));
+
+    uint32_t counter = 0;
+    BENCH_LOOP("pwm tick, per-channel writes (baseline)", ticks,
+        for (uint32_t c = 0; c < BENCH_PWM_CHANNELS; c++)
+            dmgpio_port_write_data(ports[c], pins[c], (counter < duties[c]) ? pins[c] : 0U);
+        counter = (counter + 1U) % BENCH_PWM_PERIOD);
+
+    uint32_t rounds = iterations / 100U + 1U;
+    BENCH_LOOP("pwm set_duties, 24 channels", rounds,
+        dmgpio_pwm_set_duties(pwm, 0, duties, BENCH_PWM_CHANNELS));
+
+    /* The engine is at a period boundary: the next tick takes the schedule. */
+    dmgpio_direct_access_t da[BENCH_PWM_CHANNELS];
+    uint32_t high[BENCH_PWM_CHANNELS] = { 0 };
+    for (uint32_t c = 0; c < BENCH_PWM_CHANNELS; c++)
+        dmgpio_port_get_direct_access(ports[c], pins[c], &da[c]);
+    for (uint32_t t = 0; t < BENCH_PWM_PERIOD; t++)
+    {
+        dmgpio_pwm_tick(pwm);
+        for (uint32_t c = 0; c < BENCH_PWM_CHANNELS; c++)
+            high[c] += ((*da[c].output & pins[c]) != 0U);
+    }
+    for (uint32_t c = 0; c < BENCH_PWM_CHANNELS; c++)
+    {
+        if (high[c] != duties[c])
+            printf("  ERROR: PWM channel %u high for %u of %u ticks\n",
+                (unsigned)c, (unsigned)high[c], (unsigned)duties[c]);
+    }
+    dmgpio_pwm_free(pwm);
+}
+
+/**
+ * @brief Run bench_pwm_engine on pins 0-7 of ports D, E and F, configured
+ *        as outputs by one device per port.
+ */
+static void bench_pwm(uint32_t iterations)
+{
+    dmini_context_t  output_ini[BENCH_PWM_CHANNELS / 8U];
+    dmdrvi_context_t outputs[BENCH_PWM_CHANNELS / 8U];
+    for (uint32_t p = 0; p < BENCH_PWM_CHANNELS / 8U; p++)
+    {
+        char ini_str[64];
+        snprintf(ini_str, sizeof(ini_str), "[dmgpio]\nport=%c\npins=0x00FF\nmode=output\n", 'D' + (int)p);
+        output_ini[p] = load_ini_string(ini_str);
+        outputs[p]    = (output_ini[p] != NULL) ? dmgpio_dmdrvi_create(output_ini[p], NULL) : NULL;
+    }
+
+    bench_pwm_engine(iterations);
+
+    for (uint32_t p = 0; p < BENCH_PWM_CHANNELS / 8U; p++)
+    {
+        if (outputs[p] != NULL) dmgpio_dmdrvi_free(outputs[p]);
+        if (output_ini[p] != NULL) dmini_destroy(output_ini[p]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1)
+        iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+
+    dmini_context_t output_ini = load_ini_string(s_output_ini);
+    dmini_context_t button_ini = load_ini_string(s_button_ini);
+    dmini_context_t board_ini  = load_ini_file(DMGPIO_BENCH_BOARD_INI);
+
+    dmdrvi_dev_num_t dev_num;
+    memset(&dev_num, 0, sizeof(dev_num));
+    dmdrvi_context_t ctx = dmgpio_dmdrvi_create(output_ini, &dev_num);
+    if (ctx == NULL)
+    {
+        fprintf(stderr, "Failed to create the benchmark GPIO device\n");
+        return 1;
+    }
+    void *handle = dmgpio_dmdrvi_open(ctx, DMDRVI_O_RDWR);
+
+    bench_print_header("dmgpio dmdrvi front-end (mocked port layer)");
+    bench_read_write(ctx, handle, iterations);
+    bench_ioctl(ctx, handle, iterations);
+    bench_batch(ctx, handle, iterations);
+    bench_event_queue(button_ini, iterations);
+    bench_diagnostics(button_ini, iterations);
+    bench_bus(s_bus_ini, iterations);
+    bench_bus(s_wide_bus_ini, iterations);
+    bench_configuration(ctx, board_ini, iterations);
+    bench_large_board(iterations);
+    bench_board_bring_up(iterations);
+    bench_board_table(board_ini, iterations);
+    bench_pwm(iterations);
+
+    dmgpio_dmdrvi_close(ctx, handle);
+    dmgpio_dmdrvi_free(ctx);
+    if (board_ini != NULL) dmini_destroy(board_ini);
+    dmini_destroy(button_ini);
+    dmini_destroy(output_ini);
+    return 0;
+}
@@ -0,0 +1,572 @@
+/*
+ * Port-layer benchmarks on the host simulation (src/port/host).
+ *
+ * Runs the real STM32 common implementation against register blocks in
+ * RAM and injects edges through host_port_inject_edge(), which enters
+ * stm32_gpio_exti_irq_handler() exactly like the EXTI ISRs do on target.
+ */
+#include "dmgpio_port.h"
+#include "host/host_port.h"
+#include "bench.h"
+#include "stm32_common/stm32_common.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DEFAULT_ITERATIONS    100000U
+#define BENCH_STRESS_CONTEXTS       4096U
+
+/** Busy-work iterations of the simulated slow user handler. */
+#define BENCH_SLOW_HANDLER_WORK     64U
+
+/** Edges injected between two drains of the deferred ring (below its size). */
+#define BENCH_DEFERRED_BATCH        32U
+
+/** Level changes of one simulated contact bounce, ending on the new level. */
+#define BENCH_BOUNCE_CHANGES        17U
+
+/** Debounce window of the bounce case, and cycles between two bounces. */
+#define BENCH_DEBOUNCE_US           1000U
+#define BENCH_BOUNCE_GAP_CYCLES     100U
+
+/** Edges per simulated second of the noisy input, and worker passes. */
+#define BENCH_NOISE_EDGES_PER_S     100000U
+#define BENCH_NOISE_WORKER_PER_S    1000U
+#define BENCH_MAX_INTERRUPT_RATE    1000U
+/** 100 ms windows after the noise: covers the longest backoff (64 windows). */
+#define BENCH_RECOVERY_WINDOWS      70U
+
+/** Threads of the concurrent configuration stress, four pins each. */
+#define BENCH_STRESS_THREADS        8U
+
+/** Handlers each thread of the concurrent registry stress adds per round. */
+#define BENCH_REGISTRY_HANDLERS     16U
+
+static volatile uint32_t s_handler_calls;
+
+static void bench_port_handler(void *user_ptr, dmgpio_port_t port,
+                               dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    (void)user_ptr; (void)port; (void)pins; (void)state;
+    s_handler_calls++;
+}
+
+/** A user handler that does real work in interrupt context. */
+static void bench_slow_handler(void *user_ptr, dmgpio_port_t port,
+                               dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    (void)user_ptr; (void)port; (void)pins; (void)state;
+    for (volatile uint32_t i = 0; i < BENCH_SLOW_HANDLER_WORK; i++) { }
+    s_handler_calls++;
+}
+
+/**
+ * @brief Measure dispatch of one edge on @p pin of @p port.
+ *
+ * Both edges are enabled, so every injected level change raises an
+ * interrupt.  Reports an error if any edge did not reach the handler.
+ */
+static void bench_dispatch(const char *name, dmgpio_port_t port, dmgpio_pin_t pin, uint32_t iterations)
+{
+    s_handler_calls = 0U;
+    BENCH_LOOP(name, iterations,
+        host_port_inject_edge(port, pin, (int)(bench_i_ & 1U) ^ 1));
+    if (s_handler_calls != iterations)
+        printf("  ERROR: %u of %u edges dispatched\n", (unsigned)s_handler_calls, (unsigned)iterations);
+}
+
+static void bench_interrupt_dispatch(uint32_t iterations)
+{
+    host_port_reset();
+
+    /* EXTI0 on port A: a dedicated ISR with a single handler. */
+    dmgpio_port_set_interrupt_trigger(0, 0x0001U, dmgpio_int_trigger_both_edges);
+    dmgpio_port_add_interrupt_handler(0, 0x0001U, bench_port_handler, NULL);
+    bench_dispatch("EXTI0 dispatch, 1 handler", 0, 0, iterations);
+
+    /* EXTI9_5: lines 5..9 spread over ports B..F, a full handler table on
+     * every port, and the measured edge on line 9 of port F. */
+    for (dmgpio_port_t port = 1; port <= 5; port++)
+    {
+        dmgpio_pins_mask_t line = (dmgpio_pins_mask_t)(1U << (port + 4U));
+        dmgpio_port_set_interrupt_trigger(port, line, dmgpio_int_trigger_both_edges);
+        for (uintptr_t i = 0; i < 8U; i++)
+            dmgpio_port_add_interrupt_handler(port, (i == 0U) ? line : 0U, bench_port_handler, (void *)(i + 1U));
+    }
+    bench_dispatch("EXTI9_5 dispatch, 5 ports x 8 handlers", 5, 9, iterations);
+}
+
+/**
+ * @brief Registry stress: thousands of live handler contexts on one port.
+ *
+ * Every context gets a distinct user pointer, as dmgpio device contexts do.
+ * Far beyond the former fixed limit of 8 slots per port.
+ */
+static void bench_registry_stress(uint32_t iterations)
+{
+    const dmgpio_port_t      port = 6;      /* G */
+    const dmgpio_pins_mask_t line = 0x0800U;
+
+    host_port_reset();
+    dmgpio_port_set_interrupt_trigger(port, line, dmgpio_int_trigger_both_edges);
+
+    int failures = 0;
+    BENCH_LOOP("registry add, 4096 contexts on one port", BENCH_STRESS_CONTEXTS,
+        failures += dmgpio_port_add_interrupt_handler(port, line, bench_port_handler,
+                        (void *)(uintptr_t)(bench_i_ + 1U)) != 0);
+    if (failures != 0)
+        printf("  ERROR: %d registrations failed\n", failures);
+
+    uint32_t edges = iterations / BENCH_STRESS_CONTEXTS + 1U;
+    s_handler_calls = 0U;
+    BENCH_LOOP("EXTI15_10 dispatch to 4096 handlers", edges,
+        host_port_inject_edge(port, 11, (int)(bench_i_ & 1U) ^ 1));
+    if (s_handler_calls != edges * BENCH_STRESS_CONTEXTS)
+        printf("  ERROR: %u of %u handler calls\n", (unsigned)s_handler_calls,
+            (unsigned)(edges * BENCH_STRESS_CONTEXTS));
+
+    BENCH_LOOP("registry remove, 4096 contexts", BENCH_STRESS_CONTEXTS,
+        dmgpio_port_remove_interrupt_handler(port, (void *)(uintptr_t)(bench_i_ + 1U)));
+
+    /* Create/free churn reuses pooled entries; nothing is allocated here. */
+    BENCH_LOOP("registry add+remove churn", iterations,
+        dmgpio_port_add_interrupt_handler(port, line, bench_port_handler, (void *)(uintptr_t)1U);
+        dmgpio_port_remove_interrupt_handler(port, (void *)(uintptr_t)1U));
+
+    s_handler_calls = 0U;
+    host_port_inject_edge(port, 11, 0);
+    host_port_inject_edge(port, 11, 1);
+    if (s_handler_calls != 0U)
+        printf("  ERROR: %u calls after all contexts were removed\n", (unsigned)s_handler_calls);
+}
+
+/**
+ * @brief ISR time with slow handlers run inline versus recorded for the worker.
+ *
+ * Port H, EXTI1, four slow handlers.  The deferred "ISR only" case drains
+ * the ring outside the measured time so that only the record-and-clear
+ * path of the ISR is timed; the drain is measured as its own case.
+ */
+static void bench_deferred_dispatch(uint32_t iterations)
+{
+    const dmgpio_port_t port = 7;   /* H */
+
+    host_port_reset();
+    dmgpio_port_set_interrupt_trigger(port, 0x0002U, dmgpio_int_trigger_both_edges);
+    for (uintptr_t i = 0; i < 4U; i++)
+        dmgpio_port_add_interrupt_handler(port, 0x0002U, bench_slow_handler, (void *)(i + 1U));
+
+    s_handler_calls = 0U;
+    BENCH_LOOP("EXTI1 ISR, 4 slow handlers inline", iterations,
+        host_port_inject_edge(port, 1, (int)(bench_i_ & 1U) ^ 1));
+
+    dmgpio_port_set_deferred_dispatch(port, 1);
+    BENCH_LOOP("EXTI1 ISR, deferred (record only)", iterations,
+        host_port_inject_edge(port, 1, (int)(bench_i_ & 1U) ^ 1);
+        if ((bench_i_ % BENCH_DEFERRED_BATCH) == BENCH_DEFERRED_BATCH - 1U)
+        {
+            bench_pause(&bench_case_);
+            dmgpio_port_process_deferred_interrupts(0U);
+            bench_resume(&bench_case_);
+        });
+    dmgpio_port_process_deferred_interrupts(0U);
+
+    uint32_t batches = iterations / BENCH_DEFERRED_BATCH + 1U;
+    BENCH_LOOP("deferred worker drain, per event", batches * BENCH_DEFERRED_BATCH,
+        if ((bench_i_ % BENCH_DEFERRED_BATCH) == 0U)
+        {
+            bench_pause(&bench_case_);
+            for (uint32_t edge = 0; edge < BENCH_DEFERRED_BATCH; edge++)
+                host_port_inject_edge(port, 1, (int)(edge & 1U) ^ 1);
+            bench_resume(&bench_case_);
+        }
+        dmgpio_port_process_deferred_interrupts(1U));
+
+    uint32_t expected = (iterations * 2U + batches * BENCH_DEFERRED_BATCH) * 4U;
+    uint32_t overflows = 0U;
+    dmgpio_port_read_deferred_overflows(&overflows);
+    if (s_handler_calls != expected || overflows != 0U)
+        printf("  ERROR: %u of %u handler calls, %u ring overflows\n", (unsigned)s_handler_calls,
+            (unsigned)expected, (unsigned)overflows);
+    dmgpio_port_set_deferred_dispatch(port, 0);
+}
+
+/**
+ * @brief Press and release a button once: two bursts of @p changes level
+ *        changes (1 for a clean contact), each followed by a quiet period
+ *        longer than the debounce window and a worker pass.
+ *
+ * @return Number of interrupts the bursts raised.
+ */
+static uint32_t bounce_press_release(dmgpio_port_t port, dmgpio_pin_t pin, uint32_t changes)
+{
+    uint32_t interrupts = 0U;
+    for (int target = 0; target <= 1; target++)
+    {
+        for (uint32_t change = 1U; change <= changes; change++)
+        {
+            stm32_host_dwt_cyccnt += BENCH_BOUNCE_GAP_CYCLES;
+            /* Odd changes reach the target level, even ones bounce back. */
+            int level = (change & 1U) ? target : !target;
+            interrupts += (uint32_t)(host_port_inject_edge(port, pin, level) == 1);
+        }
+        /* On the host the core clock is the 16 MHz HSI. */
+        stm32_host_dwt_cyccnt += BENCH_DEBOUNCE_US * 16U * 2U;
+        dmgpio_port_process_deferred_interrupts(0U);
+    }
+    return interrupts;
+}
+
+/**
+ * @brief A bouncing falling-edge button, without and with debounce_us:
+ *        interrupts taken and events delivered per press and release.
+ *        Then a clean button with debounce_us, whose release raises no
+ *        interrupt at all: every press must still be delivered.
+ */
+static void bench_debounce(uint32_t iterations)
+{
+    const dmgpio_port_t port = 2;   /* C, as button_b1 on the Nucleo boards */
+    const dmgpio_pin_t  pin  = 13;
+
+    host_port_reset();
+    stm32_host_gpio[port].IDR = 1U << pin;      /* released, pulled up */
+    dmgpio_port_set_interrupt_trigger(port, 1U << pin, dmgpio_int_trigger_falling_edge);
+    dmgpio_port_add_interrupt_handler(port, 1U << pin, bench_port_handler, NULL);
+
+    uint32_t rounds = iterations / 100U + 1U;
+    for (uint32_t debounce_us = 0U; debounce_us <= BENCH_DEBOUNCE_US; debounce_us += BENCH_DEBOUNCE_US)
+    {
+        dmgpio_port_set_debounce(port, 1U << pin, debounce_us);
+        uint32_t interrupts = 0U;
+        s_handler_calls = 0U;
+        BENCH_LOOP(debounce_us ? "bouncing button, debounce_us=1000" : "bouncing button, no debounce", rounds,
+            interrupts += bounce_press_release(port, pin, BENCH_BOUNCE_CHANGES));
+        printf("  %u interrupts, %u events per press and release\n",
+            (unsigned)(interrupts / rounds), (unsigned)(s_handler_calls / rounds));
+        if (debounce_us != 0U && s_handler_calls != rounds)
+            printf("  ERROR: %u events for %u presses\n", (unsigned)s_handler_calls, (unsigned)rounds);
+    }
+
+    s_handler_calls = 0U;
+    BENCH_LOOP("clean button, debounce_us=1000", rounds,
+        bounce_press_release(port, pin, 1U));
+    if (s_handler_calls != rounds)
+        printf("  ERROR: %u events for %u presses\n", (unsigned)s_handler_calls, (unsigned)rounds);
+    dmgpio_port_set_debounce(port, 1U << pin, 0U);
+}
+
+/**
+ * @brief Toggle a floating input for one simulated second while a worker
+ *        runs BENCH_NOISE_WORKER_PER_S times.
+ *
+ * @return Number of interrupts the noise raised.
+ */
+static uint32_t noise_second(dmgpio_port_t port, dmgpio_pin_t pin)
+{
+    /* On the host the core clock is the 16 MHz HSI. */
+    const uint32_t edge_cycles = 16000000U / BENCH_NOISE_EDGES_PER_S;
+    const uint32_t worker_edges = BENCH_NOISE_EDGES_PER_S / BENCH_NOISE_WORKER_PER_S;
+    uint32_t interrupts = 0U;
+    for (uint32_t edge = 0U; edge < BENCH_NOISE_EDGES_PER_S; edge++)
+    {
+        stm32_host_dwt_cyccnt += edge_cycles;
+        interrupts += (uint32_t)(host_port_inject_edge(port, pin, (int)(edge & 1U) ^ 1) == 1);
+        if (edge % worker_edges == worker_edges - 1U)
+            dmgpio_port_process_deferred_interrupts(0U);
+    }
+    return interrupts;
+}
+
+/**
+ * @brief A floating EXTI15_10 input, without and with max_interrupt_rate:
+ *        interrupts taken per second, and recovery of the line afterwards.
+ */
+static void bench_interrupt_storm(uint32_t iterations)
+{
+    const dmgpio_port_t port = 3;   /* D */
+    const dmgpio_pin_t  pin  = 12;
+
+    host_port_reset();
+    dmgpio_port_set_interrupt_trigger(port, 1U << pin, dmgpio_int_trigger_both_edges);
+    dmgpio_port_add_interrupt_handler(port, 1U << pin, bench_port_handler, NULL);
+
+    uint32_t seconds = iterations / 20000U + 1U;
+    for (uint32_t limit = 0U; limit <= BENCH_MAX_INTERRUPT_RATE; limit += BENCH_MAX_INTERRUPT_RATE)
+    {
+        dmgpio_port_set_rate_limit(port, 1U << pin, limit);
+        uint32_t interrupts = 0U;
+        s_handler_calls = 0U;
+        BENCH_LOOP(limit ? "noisy input, max_interrupt_rate=1000" : "noisy input, no rate limit", seconds,
+            interrupts += noise_second(port, pin));
+        dmgpio_rate_limit_stats_t stats;
+        dmgpio_port_read_rate_limit_stats(port, 1U << pin, &stats);
+        printf("  %u interrupts, %u events per second; %u storms\n", (unsigned)(interrupts / seconds),
+            (unsigned)(s_handler_calls / seconds), (unsigned)stats.storms);
+    }
+
+    /* Once the noise stops, the line is unmasked after its backoff and
+     * dispatches in the ISR again. */
+    for (uint32_t window = 0U; window < BENCH_RECOVERY_WINDOWS; window++)
+    {
+        stm32_host_dwt_cyccnt += 16000000U / 10U;
+        dmgpio_port_process_deferred_interrupts(0U);
+    }
+    stm32_host_dwt_cyccnt += 16000000U;
+    s_handler_calls = 0U;
+    int dispatched = host_port_inject_edge(port, pin, !(stm32_host_gpio[port].IDR & (1U << pin)));
+    dmgpio_rate_limit_stats_t stats;
+    dmgpio_port_read_rate_limit_stats(port, 1U << pin, &stats);
+    if (dispatched != 1 || s_handler_calls != 1U || stats.throttled != 0U)
+        printf("  ERROR: line not re-enabled after the storm (dispatched %d, throttled 0x%04X)\n",
+            dispatched, (unsigned)stats.throttled);
+    dmgpio_port_set_rate_limit(port, 1U << pin, 0U);
+}
+
+/**
+ * @brief Work of one thread of the concurrent configuration stress.
+ */
+typedef struct
+{
+    dmgpio_port_t       port;
+    dmgpio_pins_mask_t  pins;
+    uint8_t             af;         /**< Final alternate function, unique per thread */
+    int                 exti;       /**< The thread also owns the EXTI lines of its pins */
+    uint32_t            rounds;
+    uint32_t            lost;       /**< Rounds whose settings another thread overwrote */
+} bench_stress_worker_t;
+
+static void stress_configure(const bench_stress_worker_t *w, uint32_t round, uint8_t af)
+{
+    int odd = (int)(round & 1U);
+    dmgpio_port_set_mode(w->port, w->pins, odd ? dmgpio_mode_output : dmgpio_mode_alternate);
+    dmgpio_port_set_pull(w->port, w->pins, odd ? dmgpio_pull_up : dmgpio_pull_down);
+    dmgpio_port_set_speed(w->port, w->pins, odd ? dmgpio_speed_medium : dmgpio_speed_maximum);
+    dmgpio_port_set_output_circuit(w->port, w->pins,
+        odd ? dmgpio_output_circuit_open_drain : dmgpio_output_circuit_push_pull);
+    dmgpio_port_set_alternate_function(w->port, w->pins, af);
+    if (w->exti)
+        dmgpio_port_set_interrupt_trigger(w->port, w->pins,
+            odd ? dmgpio_int_trigger_rising_edge : dmgpio_int_trigger_off);
+    dmgpio_port_toggle_pins_state(w->port, w->pins);
+}
+
+/**
+ * @brief Check, through the port readers, that the settings of @p round
+ *        are still in place on the lowest pin of the thread.
+ */
+static int stress_verify(const bench_stress_worker_t *w, uint32_t round, uint8_t af)
+{
+    int odd = (int)(round & 1U);
+    dmgpio_mode_t           mode;
+    dmgpio_pull_t           pull;
+    dmgpio_speed_t          speed;
+    dmgpio_output_circuit_t oc;
+    uint8_t                 read_af;
+    dmgpio_int_trigger_t    trigger = dmgpio_int_trigger_off;
+    dmgpio_port_read_mode(w->port, w->pins, &mode);
+    dmgpio_port_read_pull(w->port, w->pins, &pull);
+    dmgpio_port_read_speed(w->port, w->pins, &speed);
+    dmgpio_port_read_output_circuit(w->port, w->pins, &oc);
+    dmgpio_port_read_alternate_function(w->port, w->pins, &read_af);
+    if (w->exti)
+        dmgpio_port_read_interrupt_trigger(w->port, w->pins, &trigger);
+    return mode  == (odd ? dmgpio_mode_output : dmgpio_mode_alternate) &&
+           pull  == (odd ? dmgpio_pull_up : dmgpio_pull_down) &&
+           speed == (odd ? dmgpio_speed_medium : dmgpio_speed_maximum) &&
+           oc    == (odd ? dmgpio_output_circuit_open_drain : dmgpio_output_circuit_push_pull) &&
+           read_af == af &&
+           trigger == ((w->exti && odd) ? dmgpio_int_trigger_rising_edge : dmgpio_int_trigger_off);
+}
+
+static void *stress_worker(void *arg)
+{
+    bench_stress_worker_t *w = (bench_stress_worker_t *)arg;
+    for (uint32_t round = 0; round < w->rounds; round++)
+    {
+        if (round > 0U && !stress_verify(w, round - 1U, (uint8_t)((round - 1U) & 0xFU)))
+            w->lost++;
+
+        /* Every fourth round goes through a session shared with the others */
+        if ((round & 3U) == 0U)
+        {
+            dmgpio_port_begin_configuration(w->port, w->pins);
+            stress_configure(w, round, (uint8_t)(round & 0xFU));
+            dmgpio_port_finish_configuration(w->port, w->pins);
+        }
+        else
+        {
+            stress_configure(w, round, (uint8_t)(round & 0xFU));
+        }
+    }
+    /* Odd round: output, pull-up, medium, open-drain, rising edge */
+    stress_configure(w, 1U, w->af);
+    return NULL;
+}
+
+/**
+ * @brief Count the pins of @p w whose registers do not hold its final settings.
+ */
+static uint32_t stress_check(const bench_stress_worker_t *w)
+{
+    uint32_t errors = 0U;
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        if (!(w->pins & (1U << pin))) continue;
+        const stm32_gpio_t *gpio = STM32_GPIO(w->port);
+        uint32_t shift = pin * 2U;
+        errors += ((gpio->MODER >> shift) & 3U) != 1U;
+        errors += ((gpio->PUPDR >> shift) & 3U) != 1U;
+        errors += ((gpio->OSPEEDR >> shift) & 3U) != 1U;
+        errors += ((gpio->OTYPER >> pin) & 1U) != 1U;
+        errors += ((gpio->AFR[pin / 8U] >> ((pin % 8U) * 4U)) & 0xFU) != w->af;
+        if (w->exti)
+        {
+            errors += ((STM32_SYSCFG_EXTICR[pin / 4U] >> ((pin % 4U) * 4U)) & 0xFU) != w->port;
+            errors += ((STM32_EXTI->RTSR >> pin) & 1U) != 1U;
+            errors += ((STM32_EXTI->FTSR >> pin) & 1U) != 0U;
+            errors += ((STM32_EXTI->IMR  >> pin) & 1U) != 1U;
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief Configure pins of the same ports from several threads at once and
+ *        check that no read-modify-write was lost.
+ *
+ * Each thread owns four pins and reconfigures them (every configuration
+ * register, toggles and, on the first port, the EXTI routing shared by all
+ * ports) over and over, then applies a final configuration unique to the
+ * thread.  Each round first checks that the previous round's settings
+ * survived, and the final settings are checked at the end; any lost update
+ * shows up as a field of this thread holding a value it did not write.  Run with all threads on two ports, then with
+ * each thread on a port of its own.
+ */
+static void bench_concurrent_configuration(const char *name, uint32_t ports, uint32_t iterations)
+{
+    bench_stress_worker_t workers[BENCH_STRESS_THREADS];
+    pthread_t             threads[BENCH_STRESS_THREADS];
+    uint32_t              rounds = iterations / BENCH_STRESS_THREADS + 1U;
+
+    host_port_reset();
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+    {
+        uint32_t per_port = BENCH_STRESS_THREADS / ports;
+        workers[t].port   = (dmgpio_port_t)(3U + t / per_port);     /* from D */
+        workers[t].pins   = (dmgpio_pins_mask_t)(0xFU << ((t % 4U) * 4U));
+        workers[t].af     = (uint8_t)(t + 1U);
+        workers[t].exti   = (t < 4U);       /* lines 0-15 once, on the first port */
+        workers[t].rounds = rounds;
+        workers[t].lost   = 0U;
+    }
+
+    bench_case_t bench;
+    bench_begin(&bench, name, rounds * BENCH_STRESS_THREADS);
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+        pthread_create(&threads[t], NULL, stress_worker, &workers[t]);
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+        pthread_join(threads[t], NULL);
+    bench_end(&bench);
+
+    uint32_t errors = 0U;
+    uint32_t lost   = 0U;
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+    {
+        errors += stress_check(&workers[t]);
+        lost   += workers[t].lost;
+    }
+    if (errors != 0U || lost != 0U)
+        printf("  ERROR: %u rounds overwritten, %u final register fields wrong\n",
+            (unsigned)lost, (unsigned)errors);
+}
+
+/**
+ * @brief Work of one thread of the concurrent registry stress.
+ */
+typedef struct
+{
+    dmgpio_port_t       port;
+    dmgpio_pins_mask_t  line;
+    uintptr_t           first;      /**< User pointers first .. first + BENCH_REGISTRY_HANDLERS - 1 */
+    uint32_t            rounds;
+} bench_registry_worker_t;
+
+static void *registry_worker(void *arg)
+{
+    const bench_registry_worker_t *w = (const bench_registry_worker_t *)arg;
+    for (uint32_t round = 0; round < w->rounds; round++)
+    {
+        for (uintptr_t i = 0; i < BENCH_REGISTRY_HANDLERS; i++)
+            dmgpio_port_add_interrupt_handler(w->port, w->line, bench_port_handler, (void *)(w->first + i));
+        /* The last round leaves its handlers registered */
+        if (round + 1U == w->rounds) break;
+        for (uintptr_t i = 0; i < BENCH_REGISTRY_HANDLERS; i++)
+            dmgpio_port_remove_interrupt_handler(w->port, (void *)(w->first + i));
+    }
+    return NULL;
+}
+
+/**
+ * @brief Create and free handlers from several threads at once, two ports
+ *        shared by four threads each, and check that every handler left
+ *        registered is called exactly once per edge.
+ *
+ * All threads take entries from and return them to the one free list, and
+ * the threads of a port append and unlink on the same list; a lost update
+ * of either shows up as a handler missing or called twice.
+ */
+static void bench_concurrent_registry(uint32_t iterations)
+{
+    bench_registry_worker_t workers[BENCH_STRESS_THREADS];
+    pthread_t               threads[BENCH_STRESS_THREADS];
+    uint32_t                rounds = iterations / (BENCH_STRESS_THREADS * BENCH_REGISTRY_HANDLERS) + 1U;
+
+    host_port_reset();
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+    {
+        workers[t].port   = (dmgpio_port_t)(3U + t % 2U);       /* D and E */
+        workers[t].line   = (dmgpio_pins_mask_t)(1U << workers[t].port);
+        workers[t].first  = 1U + t * BENCH_REGISTRY_HANDLERS;
+        workers[t].rounds = rounds;
+        dmgpio_port_set_interrupt_trigger(workers[t].port, workers[t].line, dmgpio_int_trigger_both_edges);
+    }
+
+    bench_case_t bench;
+    bench_begin(&bench, "registry add+remove, 8 threads on 2 ports", rounds * BENCH_STRESS_THREADS * BENCH_REGISTRY_HANDLERS);
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+        pthread_create(&threads[t], NULL, registry_worker, &workers[t]);
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+        pthread_join(threads[t], NULL);
+    bench_end(&bench);
+
+    uint32_t expected = BENCH_STRESS_THREADS / 2U * BENCH_REGISTRY_HANDLERS;
+    for (dmgpio_port_t port = 3; port <= 4; port++)
+    {
+        s_handler_calls = 0U;
+        host_port_inject_edge(port, port, 1);
+        if (s_handler_calls != expected)
+            printf("  ERROR: port %c: %u of %u handlers called\n", 'A' + port,
+                (unsigned)s_handler_calls, (unsigned)expected);
+    }
+    for (uint32_t t = 0; t < BENCH_STRESS_THREADS; t++)
+        for (uintptr_t i = 0; i < BENCH_REGISTRY_HANDLERS; i++)
+            dmgpio_port_remove_interrupt_handler(workers[t].port, (void *)(workers[t].first + i));
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1)
+        iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+
+    bench_print_header("dmgpio_port (host simulation)");
+    bench_interrupt_dispatch(iterations);
+    bench_registry_stress(iterations);
+    bench_deferred_dispatch(iterations);
+    bench_debounce(iterations);
+    bench_interrupt_storm(iterations);
+    bench_concurrent_configuration("reconfigure, 8 threads on 2 ports", 2U, iterations);
+    bench_concurrent_configuration("reconfigure, 8 threads on 8 ports", 8U, iterations);
+    bench_concurrent_registry(iterations);
+    return 0;
+}
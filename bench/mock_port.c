@@ -0,0 +1,781 @@
+/*
+ * Mocked dmgpio_port layer for the benchmarks.
+ *
+ * Keeps an STM32-like register file in memory and mirrors the access
+ * pattern of src/port/stm32_common/stm32_common.c, counting every register
+ * read and write in bench_mmio_accesses.  This lets the front-end benchmarks
+ * report how many MMIO accesses each dmdrvi operation costs on target.
+ */
+#include "dmgpio_port.h"
+#include "bench.h"
+#include <stddef.h>
+
+#define MOCK_MAX_PORTS          11U
+#define MOCK_MAX_IRQ_HANDLERS   8U
+
+typedef struct
+{
+    uint32_t MODER;
+    uint32_t OTYPER;
+    uint32_t OSPEEDR;
+    uint32_t PUPDR;
+    uint32_t IDR;
+    uint32_t ODR;
+    uint32_t BSRR;
+    uint32_t LCKR;
+    uint32_t AFR[2];
+} mock_gpio_t;
+
+typedef struct
+{
+    dmgpio_port_interrupt_handler_t handler;
+    void                           *user_ptr;
+    dmgpio_pins_mask_t              pins;
+} mock_irq_entry_t;
+
+static mock_gpio_t        s_gpio[MOCK_MAX_PORTS];
+static uint32_t           s_exti_imr, s_exti_rtsr, s_exti_ftsr;
+static uint32_t           s_exticr[4];
+static uint32_t           s_ahb1enr, s_apb2enr;
+static dmgpio_pins_mask_t s_pins_used[MOCK_MAX_PORTS];
+static void              *s_pin_owners[MOCK_MAX_PORTS][16];
+static mock_irq_entry_t   s_handlers[MOCK_MAX_PORTS][MOCK_MAX_IRQ_HANDLERS];
+static uint32_t           s_event_timestamp;
+static uint32_t           s_line_interrupts[16];
+
+/** Words of mock_gpio_t, used to index the configuration shadow. */
+#define MOCK_GPIO_WORDS         (sizeof(mock_gpio_t) / sizeof(uint32_t))
+
+/** Shadow image of a port's registers during a configuration session,
+ *  as in stm32_common.c: read once when first touched, written on commit. */
+typedef struct
+{
+    uint32_t depth;
+    uint32_t loaded;
+    uint32_t dirty;
+    uint32_t value[MOCK_GPIO_WORDS];
+} mock_config_shadow_t;
+
+static mock_config_shadow_t s_config_shadow[MOCK_MAX_PORTS];
+
+static uint32_t mmio_read(const uint32_t *reg)
+{
+    bench_mmio_accesses++;
+    return *(const volatile uint32_t *)reg;
+}
+
+static void mmio_write(uint32_t *reg, uint32_t value)
+{
+    bench_mmio_accesses++;
+    *(volatile uint32_t *)reg = value;
+}
+
+/** BSRR store, with the ODR update the hardware does (not an extra access). */
+static void bsrr_write(dmgpio_port_t port, uint32_t value)
+{
+    mmio_write(&s_gpio[port].BSRR, value);
+    s_gpio[port].ODR = (s_gpio[port].ODR | (value & 0xFFFFU)) & ~(value >> 16U);
+}
+
+static int is_valid_port(dmgpio_port_t port)
+{
+    return ((uint32_t)port < MOCK_MAX_PORTS);
+}
+
+static uint32_t cfg_read(dmgpio_port_t port, uint32_t *reg)
+{
+    mock_config_shadow_t *shadow = &s_config_shadow[port];
+    uint32_t word = (uint32_t)(reg - (uint32_t *)&s_gpio[port]);
+    if (shadow->depth == 0U) return mmio_read(reg);
+    if (!(shadow->loaded & (1U << word)))
+    {
+        shadow->value[word] = mmio_read(reg);
+        shadow->loaded     |= 1U << word;
+    }
+    return shadow->value[word];
+}
+
+static void cfg_write(dmgpio_port_t port, uint32_t *reg, uint32_t value)
+{
+    mock_config_shadow_t *shadow = &s_config_shadow[port];
+    uint32_t word = (uint32_t)(reg - (uint32_t *)&s_gpio[port]);
+    if (shadow->depth == 0U)
+    {
+        mmio_write(reg, value);
+        return;
+    }
+    if (shadow->value[word] != value)
+    {
+        shadow->value[word] = value;
+        shadow->dirty      |= 1U << word;
+    }
+}
+
+static void set_2bit_fields(dmgpio_port_t port, uint32_t *reg, dmgpio_pins_mask_t pins, uint32_t value)
+{
+    uint32_t val = cfg_read(port, reg);
+    for (int pin = 0; pin < 16; pin++)
+    {
+        if (pins & (dmgpio_pins_mask_t)(1U << pin))
+        {
+            uint32_t shift = (uint32_t)pin * 2U;
+            val &= ~(3U << shift);
+            val |= (value & 3U) << shift;
+        }
+    }
+    cfg_write(port, reg, val);
+}
+
+static uint32_t read_2bit_field(dmgpio_port_t port, uint32_t *reg, dmgpio_pins_mask_t pins)
+{
+    for (int pin = 0; pin < 16; pin++)
+    {
+        if (pins & (dmgpio_pins_mask_t)(1U << pin))
+            return (cfg_read(port, reg) >> ((uint32_t)pin * 2U)) & 3U;
+    }
+    return 0U;
+}
+
+/* ---- Interrupt handlers ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _add_interrupt_handler,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_port_interrupt_handler_t handler, void *user_ptr ))
+{
+    if (!is_valid_port(port) || handler == NULL) return -1;
+    for (uint8_t i = 0; i < MOCK_MAX_IRQ_HANDLERS; i++)
+    {
+        if (s_handlers[port][i].handler == NULL)
+        {
+            s_handlers[port][i].handler  = handler;
+            s_handlers[port][i].user_ptr = user_ptr;
+            s_handlers[port][i].pins     = pins;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _remove_interrupt_handler,
+    ( dmgpio_port_t port, void *user_ptr ))
+{
+    if (!is_valid_port(port)) return -1;
+    for (uint8_t i = 0; i < MOCK_MAX_IRQ_HANDLERS; i++)
+    {
+        if (s_handlers[port][i].user_ptr == user_ptr)
+            s_handlers[port][i].handler = NULL;
+    }
+    return 0;
+}
+
+/* ---- Deferred interrupt dispatch ---- */
+
+/* The mock never raises interrupts, so there is never anything queued. */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_deferred_dispatch,
+    ( dmgpio_port_t port, int deferred ))
+{
+    if (!is_valid_port(port)) return -1;
+    (void)deferred;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _process_deferred_interrupts,
+    ( uint32_t max_events ))
+{
+    (void)max_events;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_deferred_overflows,
+    ( uint32_t *out_count ))
+{
+    if (out_count == NULL) return -1;
+    *out_count = 0U;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_event_timestamp,
+    ( uint32_t *out_timestamp ))
+{
+    if (out_timestamp == NULL) return -1;
+    *out_timestamp = s_event_timestamp;
+    return 0;
+}
+
+/* The cycle counter of the mock is the host's monotonic clock in ns. */
+dmod_dmgpio_port_api_declaration(1.0, int, _read_cycle_counter,
+    ( uint32_t *out_count ))
+{
+    if (out_count == NULL) return -1;
+    *out_count = (uint32_t)bench_clock_ns();
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_cycle_counter_rate,
+    ( uint32_t *out_hz ))
+{
+    if (out_hz == NULL) return -1;
+    *out_hz = 1000000000U;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_debounce,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t debounce_us ))
+{
+    if (!is_valid_port(port)) return -1;
+    (void)pins;
+    (void)debounce_us;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_rate_limit,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t max_per_second ))
+{
+    if (!is_valid_port(port)) return -1;
+    (void)pins;
+    (void)max_per_second;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_rate_limit_stats,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_rate_limit_stats_t *out_stats ))
+{
+    if (!is_valid_port(port) || out_stats == NULL) return -1;
+    (void)pins;
+    out_stats->storms        = 0U;
+    out_stats->polled_events = 0U;
+    out_stats->throttled     = 0U;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_diagnostics,
+    ( dmgpio_diagnostics_t *out_diag ))
+{
+    if (out_diag == NULL) return -1;
+    for (uint32_t port = 0; port < DMGPIO_DIAG_PORTS; port++)
+        out_diag->pins_used[port] = (port < MOCK_MAX_PORTS) ? s_pins_used[port] : 0U;
+    for (uint32_t i = 0; i < 4U; i++)
+        out_diag->exticr[i] = mmio_read(&s_exticr[i]);
+    out_diag->exti_imr  = mmio_read(&s_exti_imr);
+    out_diag->exti_rtsr = mmio_read(&s_exti_rtsr);
+    out_diag->exti_ftsr = mmio_read(&s_exti_ftsr);
+    for (uint32_t line = 0; line < 16U; line++)
+        out_diag->line_interrupts[line] = s_line_interrupts[line];
+
+    uint32_t count = 0U;
+    for (uint32_t port = 0; port < MOCK_MAX_PORTS; port++)
+    {
+        for (uint8_t i = 0; i < MOCK_MAX_IRQ_HANDLERS; i++)
+        {
+            const mock_irq_entry_t *entry = &s_handlers[port][i];
+            if (entry->handler == NULL)
+                continue;
+            if (count < DMGPIO_DIAG_HANDLERS)
+            {
+                out_diag->handlers[count].owner   = entry->user_ptr;
+                out_diag->handlers[count].handler = entry->handler;
+                out_diag->handlers[count].port    = (dmgpio_port_t)port;
+                out_diag->handlers[count].pins    = entry->pins;
+            }
+            count++;
+        }
+    }
+    out_diag->handler_count = count;
+    return 0;
+}
+
+/* ---- Configuration session ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _begin_configuration,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    (void)pins;
+    if (!is_valid_port(port)) return -1;
+    s_config_shadow[port].depth++;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _finish_configuration,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    (void)pins;
+    if (!is_valid_port(port)) return -1;
+    mock_config_shadow_t *shadow = &s_config_shadow[port];
+    if (shadow->depth == 0U) return -1;
+    if (--shadow->depth != 0U) return 0;
+
+    /* Same commit order as stm32_common.c: MODER last. */
+    static const uint32_t order[] = { 1U, 2U, 3U, 8U, 9U, 0U };  /* OTYPER OSPEEDR PUPDR AFR[0] AFR[1] MODER */
+    for (uint32_t i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+    {
+        if (shadow->dirty & (1U << order[i]))
+            mmio_write((uint32_t *)&s_gpio[port] + order[i], shadow->value[order[i]]);
+    }
+    shadow->loaded = 0U;
+    shadow->dirty  = 0U;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _discard_configuration,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return -1;
+    mock_config_shadow_t *shadow = &s_config_shadow[port];
+    if (shadow->depth == 0U) return -1;
+
+    /* Field masks per register word: MODER, OTYPER, OSPEEDR, PUPDR, AFR[0], AFR[1] */
+    uint32_t masks[MOCK_GPIO_WORDS] = { 0U };
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
+        masks[0] |= 3U << (pin * 2U);
+        masks[1] |= 1U << pin;
+        masks[2] |= 3U << (pin * 2U);
+        masks[3] |= 3U << (pin * 2U);
+        masks[(pin < 8U) ? 8U : 9U] |= 0xFU << ((pin % 8U) * 4U);
+    }
+    for (uint32_t loaded = shadow->loaded; loaded != 0U; loaded &= loaded - 1U)
+    {
+        uint32_t word = (uint32_t)__builtin_ctz(loaded);
+        shadow->value[word] = (shadow->value[word] & ~masks[word]) |
+                              (mmio_read((uint32_t *)&s_gpio[port] + word) & masks[word]);
+    }
+    return 0;
+}
+
+static void cfg_apply(dmgpio_port_t port, uint32_t *reg, const dmgpio_register_image_t *image)
+{
+    if (image->mask == 0U) return;
+    cfg_write(port, reg, (cfg_read(port, reg) & ~image->mask) | (image->value & image->mask));
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _apply_image,
+    ( const dmgpio_port_image_t *image ))
+{
+    if (image == NULL || !is_valid_port(image->port)) return -1;
+    dmgpio_port_t port = image->port;
+    mock_gpio_t  *gpio = &s_gpio[port];
+
+    s_config_shadow[port].depth++;
+    cfg_apply(port, &gpio->OTYPER,  &image->otyper);
+    cfg_apply(port, &gpio->OSPEEDR, &image->ospeedr);
+    cfg_apply(port, &gpio->PUPDR,   &image->pupdr);
+    cfg_apply(port, &gpio->AFR[0],  &image->afr[0]);
+    cfg_apply(port, &gpio->AFR[1],  &image->afr[1]);
+    cfg_apply(port, &gpio->MODER,   &image->moder);
+    if (dmgpio_port_finish_configuration(port, 0xFFFFU) != 0) return -1;
+
+    uint32_t lines = (uint32_t)image->exti_rising | (uint32_t)image->exti_falling;
+    if (lines == 0U) return 0;
+    mmio_write(&s_apb2enr, mmio_read(&s_apb2enr) | (1U << 14U));
+    (void)mmio_read(&s_apb2enr);
+    for (uint32_t i = 0; i < 4U; i++)
+    {
+        const dmgpio_register_image_t *cr = &image->exticr[i];
+        if (cr->mask != 0U)
+            mmio_write(&s_exticr[i], (mmio_read(&s_exticr[i]) & ~cr->mask) | (cr->value & cr->mask));
+    }
+    mmio_write(&s_exti_rtsr, (mmio_read(&s_exti_rtsr) & ~lines) | image->exti_rising);
+    mmio_write(&s_exti_ftsr, (mmio_read(&s_exti_ftsr) & ~lines) | image->exti_falling);
+    mmio_write(&s_exti_imr,  mmio_read(&s_exti_imr) | lines);
+    /* NVIC ISER, once per IRQ: EXTI0-4 have their own, 5-9 and 10-15 share one each */
+    bench_mmio_accesses += (uint32_t)__builtin_popcount(lines & 0x1FU) +
+                           ((lines & 0x3E0U) != 0U) + ((lines & 0xFC00U) != 0U);
+    return 0;
+}
+
+/* ---- Clock / power ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_power,
+    ( dmgpio_port_t port, int power_on ))
+{
+    if (!is_valid_port(port)) return -1;
+    uint32_t val = mmio_read(&s_ahb1enr);
+    if (((val & (1U << port)) != 0U) == (power_on != 0)) return 0;
+    val = power_on ? (val | (1U << port)) : (val & ~(1U << port));
+    mmio_write(&s_ahb1enr, val);
+    (void)mmio_read(&s_ahb1enr);
+    return 0;
+}
+
+/* ---- Pin protection ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, bool, _are_pins_protected,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return false;
+    uint32_t lckr = mmio_read(&s_gpio[port].LCKR);
+    if (!(lckr & (1UL << 16U))) return false;
+    return (lckr & (uint32_t)pins) != 0U;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _unlock_protection,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_protection_t protection ))
+{
+    (void)pins;
+    (void)protection;
+    return is_valid_port(port) ? 0 : -1;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _lock_protection,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return -1;
+    mmio_write(&s_gpio[port].LCKR, (1UL << 16U) | pins);
+    (void)mmio_read(&s_gpio[port].LCKR);
+    return 0;
+}
+
+/* ---- Configuration parameters ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_speed,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_speed_t speed ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (speed == dmgpio_speed_default) return 0;
+    set_2bit_fields(port, &s_gpio[port].OSPEEDR, pins, (speed == dmgpio_speed_maximum) ? 3U : (uint32_t)speed - 1U);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_speed,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_speed_t *out_speed ))
+{
+    if (!is_valid_port(port) || out_speed == NULL || pins == 0U) return -1;
+    uint32_t v = read_2bit_field(port, &s_gpio[port].OSPEEDR, pins);
+    *out_speed = (v == 0U) ? dmgpio_speed_minimum : (v == 1U) ? dmgpio_speed_medium : dmgpio_speed_maximum;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_current,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_current_t current ))
+{
+    (void)pins;
+    (void)current;
+    return is_valid_port(port) ? 0 : -1;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_current,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_current_t *out_current ))
+{
+    (void)pins;
+    if (!is_valid_port(port) || out_current == NULL) return -1;
+    *out_current = dmgpio_current_default;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_mode,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_mode_t mode ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (mode == dmgpio_mode_default) return 0;
+    set_2bit_fields(port, &s_gpio[port].MODER, pins, (uint32_t)mode - 1U);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_mode,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_mode_t *out_mode ))
+{
+    if (!is_valid_port(port) || out_mode == NULL || pins == 0U) return -1;
+    uint32_t v = read_2bit_field(port, &s_gpio[port].MODER, pins);
+    *out_mode = (v < 3U) ? (dmgpio_mode_t)(v + 1U) : dmgpio_mode_default;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_pull,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pull_t pull ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (pull == dmgpio_pull_default) return 0;
+    set_2bit_fields(port, &s_gpio[port].PUPDR, pins, (uint32_t)pull);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_pull,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pull_t *out_pull ))
+{
+    if (!is_valid_port(port) || out_pull == NULL || pins == 0U) return -1;
+    uint32_t v = read_2bit_field(port, &s_gpio[port].PUPDR, pins);
+    *out_pull = (v == 1U) ? dmgpio_pull_up : (v == 2U) ? dmgpio_pull_down : dmgpio_pull_default;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_output_circuit,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_output_circuit_t oc ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (oc == dmgpio_output_circuit_default) return 0;
+    uint32_t val = cfg_read(port, &s_gpio[port].OTYPER);
+    val = (oc == dmgpio_output_circuit_open_drain) ? (val | pins) : (val & ~(uint32_t)pins);
+    cfg_write(port, &s_gpio[port].OTYPER, val);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_output_circuit,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_output_circuit_t *out_oc ))
+{
+    if (!is_valid_port(port) || out_oc == NULL || pins == 0U) return -1;
+    *out_oc = (cfg_read(port, &s_gpio[port].OTYPER) & (pins & -pins))
+        ? dmgpio_output_circuit_open_drain : dmgpio_output_circuit_push_pull;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_alternate_function,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint8_t af ))
+{
+    if (!is_valid_port(port) || af > 15U) return -1;
+    for (int pin = 0; pin < 16; pin++)
+    {
+        if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
+        uint32_t *afr   = &s_gpio[port].AFR[pin / 8];
+        uint32_t  shift = ((uint32_t)pin % 8U) * 4U;
+        cfg_write(port, afr, (cfg_read(port, afr) & ~(0xFU << shift)) | ((uint32_t)af << shift));
+    }
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_alternate_function,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint8_t *out_af ))
+{
+    if (!is_valid_port(port) || out_af == NULL || pins == 0U) return -1;
+    for (int pin = 0; pin < 16; pin++)
+    {
+        if (pins & (dmgpio_pins_mask_t)(1U << pin))
+        {
+            *out_af = (uint8_t)((cfg_read(port, &s_gpio[port].AFR[pin / 8]) >> (((uint32_t)pin % 8U) * 4U)) & 0xFU);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_interrupt_trigger,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_int_trigger_t trigger ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (trigger & (dmgpio_int_trigger_high_level | dmgpio_int_trigger_low_level)) return -1;
+    for (int pin = 0; pin < 16; pin++)
+    {
+        if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
+        uint32_t pin_mask = 1U << (uint32_t)pin;
+        if (trigger == dmgpio_int_trigger_off)
+        {
+            mmio_write(&s_exti_imr,  mmio_read(&s_exti_imr)  & ~pin_mask);
+            mmio_write(&s_exti_rtsr, mmio_read(&s_exti_rtsr) & ~pin_mask);
+            mmio_write(&s_exti_ftsr, mmio_read(&s_exti_ftsr) & ~pin_mask);
+            bench_mmio_accesses++;  /* NVIC ICER */
+        }
+        else
+        {
+            mmio_write(&s_apb2enr, mmio_read(&s_apb2enr) | (1U << 14U));
+            (void)mmio_read(&s_apb2enr);
+            uint32_t *exticr = &s_exticr[pin / 4];
+            uint32_t  shift  = ((uint32_t)pin % 4U) * 4U;
+            mmio_write(exticr, (mmio_read(exticr) & ~(0xFU << shift)) | ((uint32_t)port << shift));
+            uint32_t rtsr = mmio_read(&s_exti_rtsr);
+            mmio_write(&s_exti_rtsr, (trigger & dmgpio_int_trigger_rising_edge) ? (rtsr | pin_mask) : (rtsr & ~pin_mask));
+            uint32_t ftsr = mmio_read(&s_exti_ftsr);
+            mmio_write(&s_exti_ftsr, (trigger & dmgpio_int_trigger_falling_edge) ? (ftsr | pin_mask) : (ftsr & ~pin_mask));
+            mmio_write(&s_exti_imr, mmio_read(&s_exti_imr) | pin_mask);
+            bench_mmio_accesses++;  /* NVIC ISER */
+        }
+    }
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_interrupt_trigger,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_int_trigger_t *out_trigger ))
+{
+    if (!is_valid_port(port) || out_trigger == NULL || pins == 0U) return -1;
+    uint32_t pin_mask = (uint32_t)(pins & -pins);
+    if (!(mmio_read(&s_exti_imr) & pin_mask))
+    {
+        *out_trigger = dmgpio_int_trigger_off;
+        return 0;
+    }
+    int rising  = (mmio_read(&s_exti_rtsr) & pin_mask) != 0U;
+    int falling = (mmio_read(&s_exti_ftsr) & pin_mask) != 0U;
+    *out_trigger = (dmgpio_int_trigger_t)((rising ? dmgpio_int_trigger_rising_edge : 0) |
+                                          (falling ? dmgpio_int_trigger_falling_edge : 0));
+    return 0;
+}
+
+/* ---- Pin usage tracking ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _claim_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ))
+{
+    if (!is_valid_port(port) || pins == 0U) return -1;
+
+    /* All or nothing: the mask only changes if none of the pins is taken */
+    dmgpio_pins_mask_t used = __atomic_load_n(&s_pins_used[port], __ATOMIC_RELAXED);
+    do
+    {
+        if ((used & pins) != 0U) return -1;
+    } while (!__atomic_compare_exchange_n(&s_pins_used[port], &used, (dmgpio_pins_mask_t)(used | pins),
+                true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    for (dmgpio_pins_mask_t p = pins; p != 0U; p &= (dmgpio_pins_mask_t)(p - 1U))
+        __atomic_store_n(&s_pin_owners[port][__builtin_ctz(p)], owner, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _release_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ))
+{
+    if (!is_valid_port(port)) return -1;
+
+    /* Only the pins still owned by @p owner are released */
+    dmgpio_pins_mask_t owned = 0U;
+    for (dmgpio_pins_mask_t p = pins; p != 0U; p &= (dmgpio_pins_mask_t)(p - 1U))
+    {
+        void *expected = owner;
+        if (__atomic_compare_exchange_n(&s_pin_owners[port][__builtin_ctz(p)], &expected, NULL,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            owned |= (dmgpio_pins_mask_t)(p & -p);
+    }
+    __atomic_fetch_and(&s_pins_used[port], (dmgpio_pins_mask_t)~owned, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_pin_owner,
+    ( dmgpio_port_t port, dmgpio_pin_t pin, void **out_owner ))
+{
+    if (!is_valid_port(port) || pin > 15U || out_owner == NULL) return -1;
+    *out_owner = __atomic_load_n(&s_pin_owners[port][pin], __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_pins_used,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return -1;
+    __atomic_fetch_or(&s_pins_used[port], pins, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_pins_unused,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return -1;
+    __atomic_fetch_and(&s_pins_used[port], (dmgpio_pins_mask_t)~pins, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _check_is_pin_used,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, int *out_used ))
+{
+    if (!is_valid_port(port) || out_used == NULL) return -1;
+    *out_used = (__atomic_load_n(&s_pins_used[port], __ATOMIC_ACQUIRE) & pins) != 0U;
+    return 0;
+}
+
+/* ---- Data read / write ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _write_data,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t data ))
+{
+    if (!is_valid_port(port)) return -1;
+    bsrr_write(port, ((uint32_t)data & pins) | ((~(uint32_t)data & pins) << 16U));
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_data,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t *out_data ))
+{
+    if (!is_valid_port(port) || out_data == NULL) return -1;
+    *out_data = (dmgpio_pins_mask_t)(mmio_read(&s_gpio[port].IDR) & pins);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _write_multi,
+    ( const dmgpio_port_t *ports, const uint32_t *set_reset, size_t count ))
+{
+    if (ports == NULL || set_reset == NULL) return -1;
+    for (size_t i = 0; i < count; i++)
+        if (!is_valid_port(ports[i])) return -1;
+    for (size_t i = 0; i < count; i++)
+        bsrr_write(ports[i], set_reset[i]);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_multi,
+    ( const dmgpio_port_t *ports, dmgpio_pins_mask_t *out_data, size_t count ))
+{
+    if (ports == NULL || out_data == NULL) return -1;
+    for (size_t i = 0; i < count; i++)
+        if (!is_valid_port(ports[i])) return -1;
+    for (size_t i = 0; i < count; i++)
+        out_data[i] = (dmgpio_pins_mask_t)mmio_read(&s_gpio[ports[i]].IDR);
+    return 0;
+}
+
+/* ---- Pin state operations ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, dmgpio_pins_mask_t, _get_high_state_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return 0U;
+    return (dmgpio_pins_mask_t)(mmio_read(&s_gpio[port].IDR) & pins);
+}
+
+dmod_dmgpio_port_api_declaration(1.0, dmgpio_pins_mask_t, _get_low_state_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return 0U;
+    return (dmgpio_pins_mask_t)(~mmio_read(&s_gpio[port].IDR) & pins);
+}
+
+dmod_dmgpio_port_api_declaration(1.0, void, _set_pins_state,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_state_t state ))
+{
+    if (!is_valid_port(port)) return;
+    bsrr_write(port, (state == dmgpio_pins_state_all_high) ? pins : ((uint32_t)pins << 16U));
+}
+
+dmod_dmgpio_port_api_declaration(1.0, void, _toggle_pins_state,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return;
+    uint32_t current_high = mmio_read(&s_gpio[port].ODR) & pins;
+    bsrr_write(port, ((uint32_t)pins & ~current_high) | (current_high << 16U));
+}
+
+/* ---- Direct register access ---- */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _get_direct_access,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_direct_access_t *out_access ))
+{
+    if (!is_valid_port(port) || out_access == NULL) return -1;
+    out_access->set_reset  = &s_gpio[port].BSRR;
+    out_access->input      = &s_gpio[port].IDR;
+    out_access->output     = &s_gpio[port].ODR;
+    out_access->set_word   = (uint32_t)pins;
+    out_access->reset_word = (uint32_t)pins << 16U;
+    out_access->pins       = pins;
+    out_access->input_bit  = NULL;
+    return 0;
+}
+
+/* ---- Interrupt simulation ---- */
+
+uint32_t bench_mock_loop_back(dmgpio_port_t port)
+{
+    if (!is_valid_port(port)) return 0U;
+    s_gpio[port].IDR = s_gpio[port].ODR;
+    return s_gpio[port].ODR;
+}
+
+void bench_mock_raise_interrupt(dmgpio_port_t port, dmgpio_pins_mask_t pins)
+{
+    if (!is_valid_port(port)) return;
+    s_event_timestamp = (uint32_t)bench_clock_ns();
+    for (uint32_t lines = pins; lines != 0U; lines &= lines - 1U)
+        s_line_interrupts[__builtin_ctz(lines)]++;
+    dmgpio_pins_mask_t state = (dmgpio_pins_mask_t)(mmio_read(&s_gpio[port].IDR) & pins);
+    for (uint8_t i = 0; i < MOCK_MAX_IRQ_HANDLERS; i++)
+    {
+        const mock_irq_entry_t *entry = &s_handlers[port][i];
+        if (entry->handler != NULL && (entry->pins & pins))
+            entry->handler(entry->user_ptr, port, entry->pins & pins, state);
+    }
+}
@@ -0,0 +1,46 @@
+# =====================================================================
+#               Board configuration tables
+# =====================================================================
+#
+#   dmgpio_add_board_config(<target> <ini> [NAME <identifier>])
+#
+#   Compiles <ini> into a constant dmgpio_board_t table at build time
+#   (cmake/dmgpio_ini_to_c.cmake), adds it to <target> and puts its
+#   header <identifier>.h on the include path of <target>.  NAME defaults
+#   to dmgpio_board_<file name>, e.g. dmgpio_board_nucleo_f767zi.
+#   Pass the table to dmgpio_create_from_board.  Invalid values in the
+#   file fail the build.
+#
+set(DMGPIO_INI_TO_C ${CMAKE_CURRENT_LIST_DIR}/dmgpio_ini_to_c.cmake)
+
+# Add the rule that generates <name>.c and <name>.h from <ini>; the path
+# of the generated source is returned in <out_c>.
+function(dmgpio_generate_board_config ini name out_c)
+    get_filename_component(ini "${ini}" ABSOLUTE)
+    set(dir ${CMAKE_CURRENT_BINARY_DIR}/dmgpio_boards)
+    add_custom_command(
+        OUTPUT  ${dir}/${name}.c ${dir}/${name}.h
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${dir}
+        COMMAND ${CMAKE_COMMAND}
+                -DINI=${ini}
+                -DNAME=${name}
+                -DOUTPUT_C=${dir}/${name}.c
+                -DOUTPUT_H=${dir}/${name}.h
+                -P ${DMGPIO_INI_TO_C}
+        DEPENDS ${ini} ${DMGPIO_INI_TO_C}
+        COMMENT "Generating GPIO board table ${name}"
+        VERBATIM
+    )
+    set(${out_c} ${dir}/${name}.c PARENT_SCOPE)
+endfunction()
+
+function(dmgpio_add_board_config target ini)
+    cmake_parse_arguments(ARG "" "NAME" "" ${ARGN})
+    if(NOT ARG_NAME)
+        get_filename_component(stem "${ini}" NAME_WE)
+        string(MAKE_C_IDENTIFIER "dmgpio_board_${stem}" ARG_NAME)
+    endif()
+    dmgpio_generate_board_config("${ini}" ${ARG_NAME} source)
+    target_sources(${target} PRIVATE ${source})
+    target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR}/dmgpio_boards)
+endfunction()
@@ -0,0 +1,541 @@
+# =====================================================================
+#               INI -> C board table generator
+# =====================================================================
+#
+#   Turns a board or MCU INI file into a constant dmgpio_board_t table
+#   (see include/dmgpio.h) with the configuration of every GPIO section
+#   and a precomputed register image of every port it uses.  The values
+#   are validated the way dmgpio_dmdrvi_create reads them, except that
+#   unknown values are errors instead of silently meaning "default".
+#
+#   Usage (normally through dmgpio_add_board_config in CMakeLists.txt):
+#       cmake -DINI=<file.ini> -DNAME=<c identifier>
+#             -DOUTPUT_C=<file.c> -DOUTPUT_H=<file.h>
+#             -P dmgpio_ini_to_c.cmake
+#
+cmake_minimum_required(VERSION 3.18)
+
+foreach(arg INI NAME OUTPUT_C OUTPUT_H)
+    if(NOT DEFINED ${arg})
+        message(FATAL_ERROR "dmgpio_ini_to_c: ${arg} is not set")
+    endif()
+endforeach()
+
+get_filename_component(SOURCE_NAME "${INI}" NAME_WE)
+set(PORT_LETTERS "ABCDEFGHIJK")
+
+macro(ini_error msg)
+    message(FATAL_ERROR "${INI}: [${sec_name}] ${msg}")
+endmacro()
+
+# ---------------------------------------------------------------------
+#   Split the file into sections
+# ---------------------------------------------------------------------
+# ';' separates CMake list elements and '[' ']' suppress the separation,
+# so all three are swapped for control characters before the file is
+# split into lines.
+string(ASCII 1 SEMI)
+string(ASCII 2 LBRACKET)
+string(ASCII 3 RBRACKET)
+
+file(READ "${INI}" content)
+string(REPLACE ";"  "${SEMI}"     content "${content}")
+string(REPLACE "["  "${LBRACKET}" content "${content}")
+string(REPLACE "]"  "${RBRACKET}" content "${content}")
+string(REPLACE "\r" ""            content "${content}")
+string(REPLACE "\n" ";"           lines   "${content}")
+
+set(sec_count 0)
+set(sec -1)
+foreach(line IN LISTS lines)
+    string(STRIP "${line}" line)
+    if(line STREQUAL "")
+        continue()
+    endif()
+    string(SUBSTRING "${line}" 0 1 first)
+    if(first STREQUAL SEMI OR first STREQUAL "#")
+        continue()
+    endif()
+
+    if(first STREQUAL LBRACKET)
+        string(FIND "${line}" "${RBRACKET}" end)
+        if(end LESS 2)
+            message(FATAL_ERROR "${INI}: invalid section header '${line}'")
+        endif()
+        math(EXPR len "${end} - 1")
+        string(SUBSTRING "${line}" 1 ${len} name)
+        set(sec ${sec_count})
+        math(EXPR sec_count "${sec_count} + 1")
+        set(SEC_${sec}_NAME "${name}")
+        set(SEC_${sec}_KEYS "")
+        continue()
+    endif()
+
+    string(FIND "${line}" "=" eq)
+    if(eq LESS 1 OR sec LESS 0)
+        continue()
+    endif()
+    string(SUBSTRING "${line}" 0 ${eq} key)
+    math(EXPR value_pos "${eq} + 1")
+    string(SUBSTRING "${line}" ${value_pos} -1 value)
+    string(STRIP "${key}" key)
+    string(STRIP "${value}" value)
+    string(REPLACE "${LBRACKET}" "[" value "${value}")
+    string(REPLACE "${RBRACKET}" "]" value "${value}")
+    string(REPLACE "${SEMI}"     ";" value "${value}")
+    list(APPEND SEC_${sec}_KEYS "${key}")
+    set(SEC_${sec}_${key} "${value}")
+endforeach()
+
+# ---------------------------------------------------------------------
+#   Value helpers
+# ---------------------------------------------------------------------
+# Parse a decimal or 0x-prefixed hex number (same syntax as parse_uint).
+function(parse_uint str max out)
+    if(NOT str MATCHES "^(0[xX][0-9a-fA-F]+|[0-9]+)$")
+        set(${out} "" PARENT_SCOPE)
+        return()
+    endif()
+    math(EXPR val "${str}")
+    if(val GREATER ${max})
+        set(${out} "" PARENT_SCOPE)
+        return()
+    endif()
+    set(${out} ${val} PARENT_SCOPE)
+endfunction()
+
+# Look up a key: out = its value, or default when the section lacks it.
+macro(get_key key default out)
+    if(DEFINED SEC_${sec}_${key})
+        set(${out} "${SEC_${sec}_${key}}")
+    else()
+        set(${out} "${default}")
+    endif()
+endmacro()
+
+# Map a value through "value=enumerator" pairs or fail.
+macro(map_key key default out)
+    get_key(${key} "${default}" _value)
+    set(${out} "")
+    foreach(_pair ${ARGN})
+        string(REPLACE "=" ";" _pair "${_pair}")
+        list(GET _pair 0 _name)
+        list(GET _pair 1 _enum)
+        if(_value STREQUAL _name)
+            set(${out} ${_enum})
+        endif()
+    endforeach()
+    if(${out} STREQUAL "")
+        set(_allowed "")
+        foreach(_pair ${ARGN})
+            string(REGEX REPLACE "=.*" "" _name "${_pair}")
+            list(APPEND _allowed ${_name})
+        endforeach()
+        string(REPLACE ";" ", " _allowed "${_allowed}")
+        ini_error("invalid '${key}=${_value}' (expected one of: ${_allowed})")
+    endif()
+endmacro()
+
+# Set field bits of a register image: var_V / var_M hold value and mask.
+macro(set_fields var pins width field_value)
+    foreach(_pin RANGE 15)
+        math(EXPR _bit "(${pins} >> ${_pin}) & 1")
+        if(_bit)
+            math(EXPR _shift "(${_pin} % (32 / ${width})) * ${width}")
+            math(EXPR _ones  "(1 << ${width}) - 1")
+            math(EXPR ${var}_M "${${var}_M} | (${_ones} << ${_shift})")
+            math(EXPR ${var}_V "(${${var}_V} & ~(${_ones} << ${_shift})) | (${field_value} << ${_shift})")
+        endif()
+    endforeach()
+endmacro()
+
+set(KNOWN_KEYS pin port pins bus mode pull speed output_circuit current protection
+               alternate_function interrupt_trigger interrupt_dispatch interrupt_handler
+               debounce_us max_interrupt_rate lazy interrupt_stats driver_name diagnostics)
+
+# ---------------------------------------------------------------------
+#   Read the GPIO sections
+# ---------------------------------------------------------------------
+set(devices "")
+set(device_count 0)
+set(used_ports "")       # ports with at least one device configured at creation
+set(exti_owner "")      # per line: port index, or "-"
+foreach(i RANGE 15)
+    list(APPEND exti_owner "-")
+endforeach()
+
+set(sec 0)
+while(sec LESS sec_count)
+    set(sec_name "${SEC_${sec}_NAME}")
+    set(is_gpio FALSE)
+    if(NOT sec_name STREQUAL "main")
+        foreach(key pin port mode bus diagnostics)
+            if(DEFINED SEC_${sec}_${key})
+                set(is_gpio TRUE)
+            endif()
+        endforeach()
+    endif()
+    if(NOT is_gpio)
+        math(EXPR sec "${sec} + 1")
+        continue()
+    endif()
+
+    foreach(key IN LISTS SEC_${sec}_KEYS)
+        if(NOT key IN_LIST KNOWN_KEYS)
+            message(WARNING "${INI}: [${sec_name}] unknown key '${key}' ignored")
+        endif()
+    endforeach()
+
+    # The diagnostics device owns no pin: its entry carries no configuration
+    map_key(diagnostics 0 diagnostics 0=false 1=true)
+    if(diagnostics STREQUAL "true")
+        string(APPEND devices
+"    {
+        .name              = \"${sec_name}\",
+        .interrupt_handler = NULL,
+        .diagnostics       = true,
+    },
+")
+        math(EXPR device_count "${device_count} + 1")
+        math(EXPR sec "${sec} + 1")
+        continue()
+    endif()
+
+    # Port and pins: "bus=PB0,PB1,..." (value bits, least significant
+    # first), "pin=PA5" / "pin=A5", or "port=A" with "pins=<mask>"
+    set(port "")
+    set(dev_ports "")       # every port of the device, its own first
+    set(bus_c "")
+    get_key(bus "" bus_str)
+    get_key(pin "" pin_str)
+    if(NOT bus_str STREQUAL "")
+        string(REPLACE "," ";" bus_items "${bus_str}")
+        set(bus_width 0)
+        set(bus_pins_c "")
+        foreach(item IN LISTS bus_items)
+            string(STRIP "${item}" item)
+            set(pin_num "")
+            if(item MATCHES "^P?([A-K])(.+)$")
+                string(FIND "${PORT_LETTERS}" "${CMAKE_MATCH_1}" item_port)
+                parse_uint("${CMAKE_MATCH_2}" 15 pin_num)
+            endif()
+            if(pin_num STREQUAL "")
+                ini_error("invalid pin '${item}' in 'bus=${bus_str}' (expected PA0-PK15 or A0-K15)")
+            endif()
+            if(NOT item_port IN_LIST dev_ports)
+                list(APPEND dev_ports ${item_port})
+                set(DEV_PINS_${item_port} 0)
+            endif()
+            list(LENGTH dev_ports dev_port_count)
+            math(EXPR pin_bit "${DEV_PINS_${item_port}} & (1 << ${pin_num})")
+            if(bus_width EQUAL 32 OR pin_bit OR dev_port_count GREATER 4)
+                ini_error("invalid 'bus=${bus_str}' (1-32 distinct pins of at most 4 ports)")
+            endif()
+            math(EXPR DEV_PINS_${item_port} "${DEV_PINS_${item_port}} | (1 << ${pin_num})")
+            math(EXPR bus_width "${bus_width} + 1")
+            string(APPEND bus_pins_c " DMGPIO_BUS_PIN(${item_port}, ${pin_num}),")
+        endforeach()
+        list(GET dev_ports 0 port)
+        set(pins ${DEV_PINS_${port}})
+        set(bus_c "
+            .bus_width          = ${bus_width},
+            .bus_pins           = {${bus_pins_c} },")
+    elseif(pin_str MATCHES "^P?([A-K])(.+)$")
+        string(FIND "${PORT_LETTERS}" "${CMAKE_MATCH_1}" port)
+        parse_uint("${CMAKE_MATCH_2}" 15 pin_num)
+        if(pin_num STREQUAL "")
+            ini_error("invalid 'pin=${pin_str}' (expected PA0-PK15 or A0-K15)")
+        endif()
+        math(EXPR pins "1 << ${pin_num}")
+    else()
+        if(NOT pin_str STREQUAL "" AND NOT DEFINED SEC_${sec}_pins)
+            ini_error("invalid 'pin=${pin_str}' (expected PA0-PK15 or A0-K15)")
+        endif()
+        get_key(port "" port_str)
+        if(NOT port_str MATCHES "^[A-K]$")
+            ini_error("invalid or missing 'port' (expected A-K, or pin=PA0-PK15)")
+        endif()
+        string(FIND "${PORT_LETTERS}" "${port_str}" port)
+        get_key(pins "" pins_str)
+        parse_uint("${pins_str}" 65535 pins)
+        if(pins STREQUAL "" OR pins EQUAL 0)
+            ini_error("invalid or missing 'pins' (must be 1-0xFFFF bitmask)")
+        endif()
+    endif()
+
+    if(dev_ports STREQUAL "")
+        set(dev_ports ${port})
+        set(DEV_PINS_${port} ${pins})
+    endif()
+
+    if(NOT DEFINED SEC_${sec}_mode)
+        ini_error("missing 'mode' (expected input/output/alternate)")
+    endif()
+    map_key(mode "" mode input=dmgpio_mode_input output=dmgpio_mode_output alternate=dmgpio_mode_alternate)
+    map_key(pull none pull none=dmgpio_pull_default default=dmgpio_pull_default up=dmgpio_pull_up down=dmgpio_pull_down)
+    map_key(speed default speed default=dmgpio_speed_default minimum=dmgpio_speed_minimum
+            medium=dmgpio_speed_medium maximum=dmgpio_speed_maximum)
+    map_key(output_circuit default output_circuit default=dmgpio_output_circuit_default
+            push_pull=dmgpio_output_circuit_push_pull open_drain=dmgpio_output_circuit_open_drain)
+    map_key(current default current default=dmgpio_current_default minimum=dmgpio_current_minimum
+            medium=dmgpio_current_medium maximum=dmgpio_current_maximum)
+    map_key(protection dont_unlock protection dont_unlock=dmgpio_protection_dont_unlock_protected_pins
+            unlock=dmgpio_protection_unlock_protected_pins)
+    map_key(interrupt_trigger off trigger off=dmgpio_int_trigger_off rising_edge=dmgpio_int_trigger_rising_edge
+            falling_edge=dmgpio_int_trigger_falling_edge both_edges=dmgpio_int_trigger_both_edges)
+    map_key(interrupt_dispatch immediate dispatch immediate=dmgpio_int_dispatch_immediate
+            deferred=dmgpio_int_dispatch_deferred)
+    map_key(lazy 0 lazy 0=false 1=true)
+    map_key(interrupt_stats 0 interrupt_stats 0=false 1=true)
+    get_key(alternate_function 0 af_str)
+    parse_uint("${af_str}" 15 af)
+    if(af STREQUAL "")
+        ini_error("invalid 'alternate_function=${af_str}' (must be 0-15)")
+    endif()
+    get_key(debounce_us 0 debounce_str)
+    parse_uint("${debounce_str}" 1000000 debounce)
+    if(debounce STREQUAL "")
+        ini_error("invalid 'debounce_us=${debounce_str}' (must be 0-1000000)")
+    endif()
+    if(debounce AND NOT dispatch STREQUAL "dmgpio_int_dispatch_deferred")
+        ini_error("'debounce_us' requires 'interrupt_dispatch=deferred'")
+    endif()
+    get_key(max_interrupt_rate 0 rate_str)
+    parse_uint("${rate_str}" 1000000 rate_limit)
+    if(rate_limit STREQUAL "")
+        ini_error("invalid 'max_interrupt_rate=${rate_str}' (must be 0-1000000)")
+    endif()
+    if(rate_limit AND NOT dispatch STREQUAL "dmgpio_int_dispatch_deferred")
+        ini_error("'max_interrupt_rate' requires 'interrupt_dispatch=deferred'")
+    endif()
+    get_key(interrupt_handler "" handler)
+
+    list(LENGTH dev_ports dev_port_count)
+    if(dev_port_count GREATER 1 AND NOT trigger STREQUAL "dmgpio_int_trigger_off")
+        ini_error("'interrupt_trigger' is not supported on a bus spanning several ports")
+    endif()
+
+    # Every port of a bus gets the same settings for its pins
+    foreach(port IN LISTS dev_ports)
+        set(pins ${DEV_PINS_${port}})
+
+        # Two devices must not share a pin
+        if(DEFINED PORT_${port}_PINS)
+            math(EXPR overlap "${PORT_${port}_PINS} & ${pins}")
+            if(overlap)
+                ini_error("pins already used by another section")
+            endif()
+        else()
+            set(PORT_${port}_PINS 0)
+            foreach(reg MODER OTYPER OSPEEDR PUPDR AFRL AFRH EXTICR0 EXTICR1 EXTICR2 EXTICR3 RISING FALLING)
+                set(PORT_${port}_${reg}_V 0)
+                set(PORT_${port}_${reg}_M 0)
+            endforeach()
+        endif()
+        math(EXPR PORT_${port}_PINS "${PORT_${port}_PINS} | ${pins}")
+
+        # Register image: the same fields apply_pin_settings() would write.
+        # Lazy devices stay out of it; the driver configures them on first access.
+        if(lazy STREQUAL "true")
+            set(image_pins 0)
+        else()
+            set(image_pins ${pins})
+            if(NOT port IN_LIST used_ports)
+                list(APPEND used_ports ${port})
+            endif()
+        endif()
+        if(mode STREQUAL "dmgpio_mode_input")
+            set_fields(PORT_${port}_MODER ${image_pins} 2 0)
+        elseif(mode STREQUAL "dmgpio_mode_output")
+            set_fields(PORT_${port}_MODER ${image_pins} 2 1)
+        else()
+            set_fields(PORT_${port}_MODER ${image_pins} 2 2)
+            math(EXPR low_pins  "${image_pins} & 0xFF")
+            math(EXPR high_pins "${image_pins} >> 8")
+            set_fields(PORT_${port}_AFRL ${low_pins}  4 ${af})
+            set_fields(PORT_${port}_AFRH ${high_pins} 4 ${af})
+        endif()
+        if(pull STREQUAL "dmgpio_pull_up")
+            set_fields(PORT_${port}_PUPDR ${image_pins} 2 1)
+        elseif(pull STREQUAL "dmgpio_pull_down")
+            set_fields(PORT_${port}_PUPDR ${image_pins} 2 2)
+        endif()
+        if(speed STREQUAL "dmgpio_speed_minimum")
+            set_fields(PORT_${port}_OSPEEDR ${image_pins} 2 0)
+        elseif(speed STREQUAL "dmgpio_speed_medium")
+            set_fields(PORT_${port}_OSPEEDR ${image_pins} 2 1)
+        elseif(speed STREQUAL "dmgpio_speed_maximum")
+            set_fields(PORT_${port}_OSPEEDR ${image_pins} 2 3)
+        endif()
+        if(output_circuit STREQUAL "dmgpio_output_circuit_push_pull")
+            set_fields(PORT_${port}_OTYPER ${image_pins} 1 0)
+        elseif(output_circuit STREQUAL "dmgpio_output_circuit_open_drain")
+            set_fields(PORT_${port}_OTYPER ${image_pins} 1 1)
+        endif()
+    endforeach()
+    list(GET dev_ports 0 port)
+    set(pins ${DEV_PINS_${port}})
+
+    if(NOT trigger STREQUAL "dmgpio_int_trigger_off")
+        foreach(line RANGE 15)
+            math(EXPR bit "(${pins} >> ${line}) & 1")
+            if(NOT bit)
+                continue()
+            endif()
+            list(GET exti_owner ${line} owner)
+            if(NOT owner STREQUAL "-" AND NOT owner EQUAL port)
+                ini_error("EXTI line ${line} is already routed to another port")
+            endif()
+            list(REMOVE_AT exti_owner ${line})
+            list(INSERT exti_owner ${line} ${port})
+            if(lazy STREQUAL "true")
+                continue()
+            endif()
+            math(EXPR cr "${line} / 4")
+            math(EXPR cr_pin "1 << (${line} % 4)")
+            set_fields(PORT_${port}_EXTICR${cr} ${cr_pin} 4 ${port})
+        endforeach()
+        if(trigger MATCHES "rising|both")
+            math(EXPR PORT_${port}_RISING_V "${PORT_${port}_RISING_V} | ${image_pins}")
+        endif()
+        if(trigger MATCHES "falling|both")
+            math(EXPR PORT_${port}_FALLING_V "${PORT_${port}_FALLING_V} | ${image_pins}")
+        endif()
+    endif()
+
+    # Device entry
+    if(handler STREQUAL "")
+        set(handler_c "NULL")
+    else()
+        set(handler_c "\"${handler}\"")
+    endif()
+    math(EXPR pins_hex "${pins}" OUTPUT_FORMAT HEXADECIMAL)
+    string(APPEND devices
+"    {
+        .name              = \"${sec_name}\",
+        .interrupt_handler = ${handler_c},
+        .config            =
+        {
+            .port               = ${port},
+            .pins               = ${pins_hex},
+            .protection         = ${protection},
+            .speed              = ${speed},
+            .current            = ${current},
+            .mode               = ${mode},
+            .pull               = ${pull},
+            .output_circuit     = ${output_circuit},
+            .alternate_function = ${af},
+            .interrupt_trigger  = ${trigger},
+            .interrupt_dispatch = ${dispatch},
+            .debounce_us        = ${debounce},
+            .max_interrupt_rate = ${rate_limit},
+            .interrupt_handler  = NULL,
+            .lazy               = ${lazy},
+            .interrupt_stats    = ${interrupt_stats},${bus_c}
+        },
+    },
+")
+    math(EXPR device_count "${device_count} + 1")
+    math(EXPR sec "${sec} + 1")
+endwhile()
+
+if(NOT device_count)
+    message(FATAL_ERROR "${INI}: no GPIO section (a section with 'pin', 'port', 'mode', 'bus' or 'diagnostics')")
+endif()
+
+# ---------------------------------------------------------------------
+#   Port images
+# ---------------------------------------------------------------------
+function(reg_image prefix out)
+    math(EXPR v "${${prefix}_V}" OUTPUT_FORMAT HEXADECIMAL)
+    math(EXPR m "${${prefix}_M}" OUTPUT_FORMAT HEXADECIMAL)
+    set(${out} "{ ${v}, ${m} }" PARENT_SCOPE)
+endfunction()
+
+list(SORT used_ports COMPARE NATURAL)
+list(LENGTH used_ports image_count)
+set(images "")
+foreach(port IN LISTS used_ports)
+    set(p PORT_${port})
+    reg_image(${p}_MODER   moder)
+    reg_image(${p}_OTYPER  otyper)
+    reg_image(${p}_OSPEEDR ospeedr)
+    reg_image(${p}_PUPDR   pupdr)
+    reg_image(${p}_AFRL    afrl)
+    reg_image(${p}_AFRH    afrh)
+    reg_image(${p}_EXTICR0 cr0)
+    reg_image(${p}_EXTICR1 cr1)
+    reg_image(${p}_EXTICR2 cr2)
+    reg_image(${p}_EXTICR3 cr3)
+    math(EXPR rising  "${${p}_RISING_V}"  OUTPUT_FORMAT HEXADECIMAL)
+    math(EXPR falling "${${p}_FALLING_V}" OUTPUT_FORMAT HEXADECIMAL)
+    string(SUBSTRING "${PORT_LETTERS}" ${port} 1 letter)
+    string(APPEND images
+"    {   /* GPIO${letter} */
+        .port         = ${port},
+        .moder        = ${moder},
+        .otyper       = ${otyper},
+        .ospeedr      = ${ospeedr},
+        .pupdr        = ${pupdr},
+        .afr          = { ${afrl}, ${afrh} },
+        .exticr       = { ${cr0}, ${cr1}, ${cr2}, ${cr3} },
+        .exti_rising  = ${rising},
+        .exti_falling = ${falling},
+    },
+")
+endforeach()
+
+# ---------------------------------------------------------------------
+#   Output
+# ---------------------------------------------------------------------
+# A board of lazy devices only has no image (and C has no empty arrays)
+if(image_count)
+    set(images_decl "static const dmgpio_port_image_t s_images[] =\n{\n${images}};\n\n")
+    set(images_ref s_images)
+else()
+    set(images_decl "")
+    set(images_ref NULL)
+endif()
+
+get_filename_component(header_name "${OUTPUT_H}" NAME)
+string(TOUPPER "${NAME}_H" guard)
+
+file(WRITE "${OUTPUT_C}.tmp"
+"/*
+ * Generated from ${SOURCE_NAME}.ini by cmake/dmgpio_ini_to_c.cmake - do not edit.
+ */
+#include \"${header_name}\"
+
+static const dmgpio_board_device_t s_devices[] =
+{
+${devices}};
+
+${images_decl}const dmgpio_board_t ${NAME} =
+{
+    .name         = \"${SOURCE_NAME}\",
+    .devices      = s_devices,
+    .device_count = ${device_count},
+    .images       = ${images_ref},
+    .image_count  = ${image_count},
+};
+")
+
+file(WRITE "${OUTPUT_H}.tmp"
+"/*
+ * Generated from ${SOURCE_NAME}.ini by cmake/dmgpio_ini_to_c.cmake - do not edit.
+ */
+#ifndef ${guard}
+#define ${guard}
+
+#include \"dmgpio.h\"
+
+/** GPIO devices of ${SOURCE_NAME}.ini, for dmgpio_create_from_board */
+extern const dmgpio_board_t ${NAME};
+
+#endif // ${guard}
+")
+
+# Only touch the outputs when they change, so dependants are not rebuilt
+configure_file("${OUTPUT_C}.tmp" "${OUTPUT_C}" COPYONLY)
+configure_file("${OUTPUT_H}.tmp" "${OUTPUT_H}" COPYONLY)
+file(REMOVE "${OUTPUT_C}.tmp" "${OUTPUT_H}.tmp")
@@ -3,6 +3,22 @@
 
 #include "dmgpio_defs.h"
 #include "dmgpio_types.h"
+#include "dmdrvi.h"
+
+/**
+ * @brief Maximum number of pins of a bus device (see bus= in the configuration)
+ */
+#define DMGPIO_BUS_MAX_WIDTH        32U
+
+/**
+ * @brief Maximum number of ports a bus device may span
+ */
+#define DMGPIO_BUS_MAX_PORTS        4U
+
+/**
+ * @brief Entry of dmgpio_config_t::bus_pins: port in the high nibble, pin in the low nibble
+ */
+#define DMGPIO_BUS_PIN(port, pin)   ((uint8_t)(((port) << 4) | (pin)))
 
 /**
  * @brief GPIO driver configuration structure
@@ -19,7 +35,122 @@ typedef struct
     dmgpio_output_circuit_t     output_circuit;     /**< Output circuit type */
     uint8_t                     alternate_function; /**< Alternate function number (0-15) */
     dmgpio_int_trigger_t        interrupt_trigger;  /**< Interrupt trigger source */
+    dmgpio_int_dispatch_t       interrupt_dispatch; /**< Run handlers in the ISR or deferred */
+    uint32_t                    debounce_us;        /**< Settling time of the inputs before an edge is reported (0 = off) */
+    uint32_t                    max_interrupt_rate; /**< Interrupts per second per pin before it is polled instead (0 = off) */
     dmgpio_interrupt_handler_t  interrupt_handler;  /**< Interrupt handler (NULL = not used) */
+    bool                        lazy;               /**< Configure the pins on first access instead of at creation */
+    bool                        interrupt_stats;    /**< Count the interrupts and their latency in dmgpio_device_stats_t */
+    uint8_t                     bus_width;          /**< Number of bus pins (0 = not a bus device) */
+    uint8_t                     bus_pins[DMGPIO_BUS_MAX_WIDTH]; /**< DMGPIO_BUS_PIN of each value bit, least significant first */
 } dmgpio_config_t;
 
+/**
+ * @brief Device of a board table generated at build time
+ */
+typedef struct
+{
+    const char         *name;               /**< Section name, used as the device name */
+    const char         *interrupt_handler;  /**< dmhaman handler name (NULL = none) */
+    dmgpio_config_t     config;             /**< Parsed and validated configuration */
+    bool                diagnostics;        /**< The read-only diagnostics device (config unused) */
+} dmgpio_board_device_t;
+
+/**
+ * @brief Path that makes dmgpio_dmdrvi_stat fill a dmgpio_stat_t
+ */
+#define DMGPIO_STAT_PATH_STATS      "stats"
+
+/**
+ * @brief Result of dmgpio_dmdrvi_stat for DMGPIO_STAT_PATH_STATS
+ *
+ * Starts with the dmdrvi_stat_t filled for any other path, so a pointer to
+ * it can be passed where dmgpio_dmdrvi_stat expects a dmdrvi_stat_t.
+ */
+typedef struct
+{
+    dmdrvi_stat_t           stat;           /**< Content size and mode */
+    dmgpio_device_stats_t   counters;       /**< Same as dmgpio_get_stats */
+} dmgpio_stat_t;
+
+/**
+ * @brief Board table generated from an INI file by cmake/dmgpio_ini_to_c.cmake
+ *
+ * Holds every GPIO device of the file together with the register image of
+ * each port it uses, so dmgpio_create_from_board needs no INI parsing.
+ */
+typedef struct
+{
+    const char                   *name;         /**< Name of the source file, without extension */
+    const dmgpio_board_device_t  *devices;      /**< Devices in file order */
+    size_t                        device_count; /**< Number of devices */
+    const dmgpio_port_image_t    *images;       /**< Register image of each used port */
+    size_t                        image_count;  /**< Number of images */
+} dmgpio_board_t;
+
+/**
+ * @brief Create every GPIO device described by a board configuration.
+ *
+ * Equivalent to calling dmgpio_dmdrvi_create for each GPIO section of
+ * @p config (in file order), but the file is scanned once, each port clock
+ * is enabled once and each port's configuration registers are written
+ * once for all of its devices.  A section that fails is logged and
+ * skipped; the others are still created.  Free each device with
+ * dmgpio_dmdrvi_free.
+ *
+ * @param config        Board configuration (e.g. configs/board/nucleo-f767zi.ini).
+ * @param out_contexts  Receives the created contexts.
+ * @param out_dev_nums  Receives the device number of each context (may be NULL).
+ * @param max_devices   Capacity of the output arrays; further sections are ignored.
+ *
+ * @return Number of devices created, or -EINVAL on invalid arguments.
+ */
+dmod_dmgpio_api(1.0, int, _create_all,
+    ( dmini_context_t config, dmdrvi_context_t *out_contexts, dmdrvi_dev_num_t *out_dev_nums, size_t max_devices ));
+
+/**
+ * @brief Create every device of a board table generated at build time.
+ *
+ * The result is the same as dmgpio_create_all on the source INI file, but
+ * nothing is parsed: each port clock is enabled once and each port image
+ * is written as is, one access per register.  Free each device with
+ * dmgpio_dmdrvi_free.
+ *
+ * @param board         Generated table (see dmgpio_add_board_config in CMakeLists.txt).
+ * @param out_contexts  Receives the created contexts.
+ * @param out_dev_nums  Receives the device number of each context (may be NULL).
+ * @param max_devices   Capacity of the output arrays; must hold every device of the table.
+ *
+ * @return Number of devices created, or -EINVAL on invalid arguments.
+ */
+dmod_dmgpio_api(1.0, int, _create_from_board,
+    ( const dmgpio_board_t *board, dmdrvi_context_t *out_contexts, dmdrvi_dev_num_t *out_dev_nums, size_t max_devices ));
+
+/**
+ * @brief Find the device that owns a pin.
+ *
+ * Every device claims its pins when it is created and releases them when
+ * it is freed; creating a device on a pin that is already owned fails.
+ *
+ * @param port  GPIO port index (0=A, 1=B, ...).
+ * @param pin   Pin number (0-15).
+ *
+ * @return Context of the owning device, or NULL if the pin is free.
+ */
+dmod_dmgpio_api(1.0, dmdrvi_context_t, _get_pin_owner, ( dmgpio_port_t port, dmgpio_pin_t pin ));
+
+/**
+ * @brief Read the usage counters and interrupt latency histogram of a device.
+ *
+ * Same counters as dmgpio_dmdrvi_stat with DMGPIO_STAT_PATH_STATS and
+ * dmgpio_ioctl_cmd_get_stats, without opening the device or counting an
+ * ioctl.  Does not configure lazy devices.
+ *
+ * @param context   Device context.
+ * @param out_stats Receives the counters.
+ *
+ * @return 0 on success, -EINVAL on invalid arguments.
+ */
+dmod_dmgpio_api(1.0, int, _get_stats, ( dmdrvi_context_t context, dmgpio_device_stats_t *out_stats ));
+
 #endif // DMGPIO_H
\ No newline at end of file
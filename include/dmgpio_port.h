@@ -5,6 +5,7 @@
 #include "dmgpio_port.h"
 #include "dmgpio_port_defs.h"
 #include "dmgpio_types.h"
+#include <stddef.h>
 
 /* --- Interrupt handlers --- */
 
@@ -13,10 +14,25 @@ dmod_dmgpio_port_api(1.0, int,  _add_interrupt_handler,
 dmod_dmgpio_port_api(1.0, int,  _remove_interrupt_handler,
     ( dmgpio_port_t port, void *user_ptr ));
 
+/* --- Deferred interrupt dispatch --- */
+
+dmod_dmgpio_port_api(1.0, int,  _set_deferred_dispatch,       ( dmgpio_port_t port, int deferred ));
+dmod_dmgpio_port_api(1.0, int,  _process_deferred_interrupts, ( uint32_t max_events ));
+dmod_dmgpio_port_api(1.0, int,  _read_deferred_overflows,     ( uint32_t *out_count ));
+dmod_dmgpio_port_api(1.0, int,  _read_event_timestamp,        ( uint32_t *out_timestamp ));
+dmod_dmgpio_port_api(1.0, int,  _read_cycle_counter,          ( uint32_t *out_count ));
+dmod_dmgpio_port_api(1.0, int,  _read_cycle_counter_rate,     ( uint32_t *out_hz ));
+dmod_dmgpio_port_api(1.0, int,  _set_debounce,                ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t debounce_us ));
+dmod_dmgpio_port_api(1.0, int,  _set_rate_limit,              ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t max_per_second ));
+dmod_dmgpio_port_api(1.0, int,  _read_rate_limit_stats,       ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_rate_limit_stats_t *out_stats ));
+dmod_dmgpio_port_api(1.0, int,  _read_diagnostics,            ( dmgpio_diagnostics_t *out_diag ));
+
 /* --- Configuration session --- */
 
-dmod_dmgpio_port_api(1.0, int,  _begin_configuration,  ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
-dmod_dmgpio_port_api(1.0, int,  _finish_configuration, ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
+dmod_dmgpio_port_api(1.0, int,  _begin_configuration,   ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
+dmod_dmgpio_port_api(1.0, int,  _finish_configuration,  ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
+dmod_dmgpio_port_api(1.0, int,  _discard_configuration, ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
+dmod_dmgpio_port_api(1.0, int,  _apply_image,           ( const dmgpio_port_image_t *image ));
 
 /* --- Clock / power --- */
 
@@ -45,8 +61,11 @@ dmod_dmgpio_port_api(1.0, int,  _read_alternate_function,( dmgpio_port_t port, d
 dmod_dmgpio_port_api(1.0, int,  _set_interrupt_trigger, ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_int_trigger_t trigger ));
 dmod_dmgpio_port_api(1.0, int,  _read_interrupt_trigger,( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_int_trigger_t *out_trigger ));
 
-/* --- Pin usage tracking --- */
+/* --- Pin usage tracking (atomic, no lock needed) --- */
 
+dmod_dmgpio_port_api(1.0, int,  _claim_pins,       ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ));
+dmod_dmgpio_port_api(1.0, int,  _release_pins,     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ));
+dmod_dmgpio_port_api(1.0, int,  _read_pin_owner,   ( dmgpio_port_t port, dmgpio_pin_t pin, void **out_owner ));
 dmod_dmgpio_port_api(1.0, int,  _set_pins_used,    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
 dmod_dmgpio_port_api(1.0, int,  _set_pins_unused,  ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
 dmod_dmgpio_port_api(1.0, int,  _check_is_pin_used,( dmgpio_port_t port, dmgpio_pins_mask_t pins, int *out_used ));
@@ -55,6 +74,8 @@ dmod_dmgpio_port_api(1.0, int,  _check_is_pin_used,( dmgpio_port_t port, dmgpio_
 
 dmod_dmgpio_port_api(1.0, int,  _write_data,          ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t data ));
 dmod_dmgpio_port_api(1.0, int,  _read_data,           ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t *out_data ));
+dmod_dmgpio_port_api(1.0, int,  _write_multi,         ( const dmgpio_port_t *ports, const uint32_t *set_reset, size_t count ));
+dmod_dmgpio_port_api(1.0, int,  _read_multi,          ( const dmgpio_port_t *ports, dmgpio_pins_mask_t *out_data, size_t count ));
 
 /* --- Pin state operations (no argument checking, must ensure correct pins) --- */
 
@@ -63,4 +84,8 @@ dmod_dmgpio_port_api(1.0, dmgpio_pins_mask_t, _get_low_state_pins,  ( dmgpio_por
 dmod_dmgpio_port_api(1.0, void, _set_pins_state,      ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_state_t state ));
 dmod_dmgpio_port_api(1.0, void, _toggle_pins_state,   ( dmgpio_port_t port, dmgpio_pins_mask_t pins ));
 
+/* --- Direct register access --- */
+
+dmod_dmgpio_port_api(1.0, int,  _get_direct_access,   ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_direct_access_t *out_access ));
+
 #endif // DMGPIO_PORT_H
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef DMGPIO_PWM_H
+#define DMGPIO_PWM_H
+
+#include "dmgpio_defs.h"
+#include "dmgpio_types.h"
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of channels of one PWM engine
+ *
+ * A channel is a group of pins of one port that share a duty cycle, so an
+ * engine can drive more pins than it has channels.
+ */
+#define DMGPIO_PWM_MAX_CHANNELS     32U
+
+/**
+ * @brief Opaque software PWM engine (see dmgpio_pwm_create)
+ */
+struct dmgpio_pwm;
+typedef struct dmgpio_pwm *dmgpio_pwm_t;
+
+/**
+ * @brief Create a software PWM engine.
+ *
+ * The engine is driven by dmgpio_pwm_tick, which must be called at a fixed
+ * rate (typically from a timer interrupt); a period lasts @p period_ticks
+ * calls.  All channels start a period high and go low when their duty
+ * cycle expires, and every edge is one BSRR store per port, whatever the
+ * number of channels switching at that tick.
+ *
+ * @param period_ticks  Length of a period in ticks (at least 2).
+ *
+ * @return New engine, or NULL on invalid arguments or allocation failure.
+ */
+dmod_dmgpio_api(1.0, dmgpio_pwm_t, _pwm_create, ( uint32_t period_ticks ));
+
+/**
+ * @brief Drive all channels low and free the engine.
+ *
+ * dmgpio_pwm_tick must not run anymore when this is called.
+ */
+dmod_dmgpio_api(1.0, void, _pwm_free, ( dmgpio_pwm_t pwm ));
+
+/**
+ * @brief Add a channel to the engine.
+ *
+ * The pins must already be configured as outputs, e.g. by a dmgpio device
+ * with mode=output; the engine only writes their state.  The channel takes
+ * effect at the next period.
+ *
+ * @param pwm   Engine.
+ * @param port  GPIO port index (0=A, 1=B, ...).
+ * @param pins  Pins driven together by the channel.
+ * @param duty  High time in ticks (0 = always low, period = always high).
+ *
+ * @return Channel number (>= 0), -EINVAL on invalid arguments or pins that
+ *         are not outputs of a configured device, -EBUSY if a
+ *         pin is already driven by another channel, -ENOMEM if the engine
+ *         has DMGPIO_PWM_MAX_CHANNELS channels.
+ */
+dmod_dmgpio_api(1.0, int, _pwm_add_channel,
+    ( dmgpio_pwm_t pwm, dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t duty ));
+
+/**
+ * @brief Change the duty cycle of one channel.
+ *
+ * Equivalent to dmgpio_pwm_set_duties with a single value.
+ */
+dmod_dmgpio_api(1.0, int, _pwm_set_duty, ( dmgpio_pwm_t pwm, int channel, uint32_t duty ));
+
+/**
+ * @brief Change the duty cycles of consecutive channels at once.
+ *
+ * The new edge schedule is built in the inactive buffer and taken over by
+ * dmgpio_pwm_tick at the next period boundary, so a period never mixes old
+ * and new values.  Updates may run while dmgpio_pwm_tick runs (e.g. in an
+ * interrupt), but not concurrently with each other or dmgpio_pwm_add_channel.
+ *
+ * @param pwm       Engine.
+ * @param first     First channel to update.
+ * @param duties    New high times in ticks, one per channel.
+ * @param count     Number of channels to update.
+ *
+ * @return 0 on success, -EINVAL on invalid arguments.
+ */
+dmod_dmgpio_api(1.0, int, _pwm_set_duties,
+    ( dmgpio_pwm_t pwm, int first, const uint32_t *duties, size_t count ));
+
+/**
+ * @brief Advance the engine by one tick and write the edges due.
+ *
+ * Costs one comparison on ticks without an edge and one BSRR store per
+ * port with switching pins otherwise.  No argument checking.
+ */
+dmod_dmgpio_api(1.0, void, _pwm_tick, ( dmgpio_pwm_t pwm ));
+
+#endif // DMGPIO_PWM_H
@@ -115,9 +115,160 @@ typedef enum
     dmgpio_ioctl_cmd_set_pins_state,            /**< Set new pins state */
     dmgpio_ioctl_cmd_get_high_pins_state,       /**< Read pins that are in high state */
     dmgpio_ioctl_cmd_get_low_pins_state,        /**< Read pins that are in low state */
-    dmgpio_ioctl_cmd_set_interrupt_handler      /**< Add an interrupt handler; arg = dmgpio_interrupt_handler_t* */
+    dmgpio_ioctl_cmd_set_interrupt_handler,     /**< Add an interrupt handler; arg = dmgpio_interrupt_handler_t* */
+    dmgpio_ioctl_cmd_set_data_format,           /**< Select read/write data format; arg = dmgpio_data_format_t* */
+    dmgpio_ioctl_cmd_get_data_format,           /**< Read the current data format; arg = dmgpio_data_format_t* */
+    dmgpio_ioctl_cmd_get_direct_access,         /**< Get register descriptor for the pins; arg = dmgpio_direct_access_t* */
+    dmgpio_ioctl_cmd_process_interrupts,        /**< Run handlers of deferred interrupts, settled debounced inputs and polled throttled pins; arg = uint32_t* (in: max events, 0 = all; out: events processed) */
+    dmgpio_ioctl_cmd_set_read_timeout,          /**< Event read timeout in ms, waited in 1 ms polls; arg = uint32_t* (0 = non-blocking, DMGPIO_READ_TIMEOUT_INFINITE) */
+    dmgpio_ioctl_cmd_get_event_overflows,       /**< Read the number of events lost to a full queue; arg = uint32_t* */
+    dmgpio_ioctl_cmd_get_rate_limit_stats,      /**< Read the interrupt storm counters of the pins; arg = dmgpio_rate_limit_stats_t* */
+    dmgpio_ioctl_cmd_get_stats,                 /**< Read the usage counters and latency histogram of the device; arg = dmgpio_device_stats_t* */
+    dmgpio_ioctl_cmd_get_diagnostics,           /**< Take a snapshot of the state of all ports; arg = dmgpio_diagnostics_t* */
+    dmgpio_ioctl_cmd_set_bus_direction,         /**< Switch all pins of a bus device; arg = dmgpio_mode_t* (input or output) */
+    dmgpio_ioctl_cmd_run_batch                  /**< Run a sequence of pin operations in one call; arg = dmgpio_batch_t* */
 } dmgpio_ioctl_cmd_t;
 
+/** Read timeout that blocks until at least one event is available */
+#define DMGPIO_READ_TIMEOUT_INFINITE    0xFFFFFFFFUL
+
+/**
+ * @brief Where the handlers of an interrupt run
+ */
+typedef enum
+{
+    dmgpio_int_dispatch_immediate = 0,  /**< In the EXTI ISR (default) */
+    dmgpio_int_dispatch_deferred        /**< In the context that calls dmgpio_ioctl_cmd_process_interrupts */
+} dmgpio_int_dispatch_t;
+
+/**
+ * @brief Data format of the device read/write interface
+ */
+typedef enum
+{
+    dmgpio_data_format_text = 0,    /**< "0x%04X" string on read, decimal/hex string on write (default) */
+    dmgpio_data_format_raw,         /**< Little-endian dmgpio_pins_mask_t (2 bytes) on read and write */
+    dmgpio_data_format_events       /**< Read returns queued dmgpio_event_t records; write as in text */
+} dmgpio_data_format_t;
+
+/**
+ * @brief Direct register access descriptor for a group of pins
+ *
+ * Lets time-critical code drive the pins with a single store, bypassing the
+ * dmdrvi dispatch and the port layer.  The addresses stay valid for the
+ * lifetime of the device; accesses through them are not checked.
+ *
+ * Example: `*da.set_reset = da.set_word;` drives all pins high.
+ */
+typedef struct
+{
+    volatile uint32_t       *set_reset;     /**< Atomic set/reset register (STM32: BSRR) */
+    volatile const uint32_t *input;         /**< Input data register (STM32: IDR) */
+    volatile uint32_t       *output;        /**< Output data register (STM32: ODR) */
+    volatile const uint32_t *input_bit;     /**< Single pin only: reads 0/1, its input bit (STM32F4: IDR bit-band alias); NULL if not available */
+    uint32_t                 set_word;      /**< set_reset value that drives all pins high */
+    uint32_t                 reset_word;    /**< set_reset value that drives all pins low */
+    dmgpio_pins_mask_t       pins;          /**< Pins covered by the words (bit N = pin N in input/output) */
+} dmgpio_direct_access_t;
+
+/**
+ * @brief Operation of a dmgpio_batch_t
+ */
+typedef enum
+{
+    dmgpio_batch_op_set = 0,        /**< Drive the pins in value high (value &= device pins) */
+    dmgpio_batch_op_reset,          /**< Drive the pins in value low */
+    dmgpio_batch_op_toggle,         /**< Toggle the pins in value */
+    dmgpio_batch_op_write,          /**< Drive all pins from value, as a raw _write */
+    dmgpio_batch_op_read            /**< Store the pin state in value, as a raw _read */
+} dmgpio_batch_op_code_t;
+
+/**
+ * @brief One step of dmgpio_ioctl_cmd_run_batch
+ */
+typedef struct
+{
+    dmgpio_batch_op_code_t  op;     /**< Operation */
+    uint32_t                value;  /**< Pin mask or value; receives the result of a read */
+} dmgpio_batch_op_t;
+
+/**
+ * @brief Argument of dmgpio_ioctl_cmd_run_batch
+ *
+ * The operations run in order on the device's pins, with the checks of
+ * the ioctl done once for the whole batch.
+ */
+typedef struct
+{
+    dmgpio_batch_op_t  *ops;        /**< Operations, executed in order */
+    uint32_t            count;      /**< Number of operations */
+} dmgpio_batch_t;
+
+/**
+ * @brief Interrupt storm counters of a group of pins (see max_interrupt_rate)
+ */
+typedef struct
+{
+    uint32_t            storms;         /**< Times a pin exceeded its budget and was masked */
+    uint32_t            polled_events;  /**< Events dispatched by polling while masked */
+    dmgpio_pins_mask_t  throttled;      /**< Pins masked and polled right now */
+} dmgpio_rate_limit_stats_t;
+
+/** Buckets of the interrupt latency histogram, one per power of two */
+#define DMGPIO_LATENCY_BUCKETS          32U
+
+/**
+ * @brief Usage counters of a device (see dmgpio_ioctl_cmd_get_stats)
+ *
+ * Latencies are measured from the entry of the EXTI ISR to the start of
+ * the device's handlers, in ticks of the port's cycle counter (core clock
+ * cycles on STM32).  latency[N] counts the interrupts whose latency was in
+ * [2^N, 2^(N+1)); latency[0] also counts a latency of 0.  interrupts,
+ * latency_max and latency stay 0 unless the device has interrupt_stats=1.
+ * Counters wrap.
+ */
+typedef struct
+{
+    uint32_t    reads;                  /**< Calls of _read */
+    uint32_t    writes;                 /**< Calls of _write */
+    uint32_t    ioctls;                 /**< Calls of _ioctl, including toggles */
+    uint32_t    toggles;                /**< dmgpio_ioctl_cmd_toggle_pins calls and batched toggles */
+    uint32_t    interrupts;             /**< Interrupts delivered to the device's handlers */
+    uint32_t    interrupts_dropped;     /**< Events lost to a full event queue */
+    uint32_t    interrupt_storms;       /**< Times max_interrupt_rate masked a pin of the device */
+    uint32_t    latency_max;            /**< Longest latency seen, in ticks */
+    uint32_t    counter_hz;             /**< Ticks per second of the cycle counter (0 = unknown) */
+    uint32_t    latency[DMGPIO_LATENCY_BUCKETS];    /**< Latency histogram (log2 buckets) */
+} dmgpio_device_stats_t;
+
+/**
+ * @brief Value of some fields of a register
+ */
+typedef struct
+{
+    uint32_t value;     /**< New field values (bits outside mask are ignored) */
+    uint32_t mask;      /**< Bits set by the image; the other bits keep their value */
+} dmgpio_register_image_t;
+
+/**
+ * @brief Precomputed configuration of one GPIO port (STM32 register layout)
+ *
+ * Generated at build time from a board file by cmake/dmgpio_ini_to_c.cmake
+ * and written by dmgpio_port_apply_image without any per-pin work.
+ */
+typedef struct
+{
+    dmgpio_port_t           port;           /**< GPIO port index (0=A, 1=B, ...) */
+    dmgpio_register_image_t moder;          /**< Mode register */
+    dmgpio_register_image_t otyper;         /**< Output type register */
+    dmgpio_register_image_t ospeedr;        /**< Output speed register */
+    dmgpio_register_image_t pupdr;          /**< Pull-up/pull-down register */
+    dmgpio_register_image_t afr[2];         /**< Alternate function registers (pins 0-7, 8-15) */
+    dmgpio_register_image_t exticr[4];      /**< SYSCFG_EXTICR routing of the EXTI lines to this port */
+    dmgpio_pins_mask_t      exti_rising;    /**< EXTI lines enabled on the rising edge */
+    dmgpio_pins_mask_t      exti_falling;   /**< EXTI lines enabled on the falling edge */
+} dmgpio_port_image_t;
+
 /**
  * @brief Opaque driver context type (forward declaration)
  *
@@ -140,6 +291,15 @@ typedef struct
     dmgpio_pins_mask_t state;  /**< Current pin state bitmask (bit N high = pin N is high) */
 } dmgpio_interrupt_params_t;
 
+/**
+ * @brief Edge event record returned by reads in dmgpio_data_format_events.
+ */
+typedef struct
+{
+    uint32_t                  timestamp;    /**< Core cycle counter at the interrupt (wraps) */
+    dmgpio_interrupt_params_t params;       /**< Port, pins that fired and their state */
+} dmgpio_event_t;
+
 /**
  * @brief GPIO interrupt handler function type
  *
@@ -165,4 +325,40 @@ typedef void (*dmgpio_interrupt_handler_t)(dmdrvi_context_t context, dmgpio_port
  */
 typedef void (*dmgpio_port_interrupt_handler_t)(void *user_ptr, dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state);
 
+/** Ports covered by dmgpio_diagnostics_t (GPIOA-GPIOK) */
+#define DMGPIO_DIAG_PORTS               11U
+
+/** Handler registrations listed in dmgpio_diagnostics_t */
+#define DMGPIO_DIAG_HANDLERS            32U
+
+/**
+ * @brief One interrupt handler registration of the port layer
+ */
+typedef struct
+{
+    void                           *owner;      /**< User pointer of the registration (driver handlers: device context) */
+    dmgpio_port_interrupt_handler_t handler;    /**< Registered function */
+    dmgpio_port_t                   port;       /**< GPIO port index */
+    dmgpio_pins_mask_t              pins;       /**< Pins the handler is called for */
+} dmgpio_diag_handler_t;
+
+/**
+ * @brief Snapshot of the port layer state (see dmgpio_ioctl_cmd_get_diagnostics)
+ *
+ * The pin and EXTI fields are taken in one critical section, so they
+ * describe the same instant; the handlers of each port are copied under
+ * that port's lock and listed in dispatch order.
+ */
+typedef struct
+{
+    dmgpio_pins_mask_t      pins_used[DMGPIO_DIAG_PORTS];   /**< Pins owned by a device, per port */
+    uint32_t                exticr[4];                      /**< SYSCFG_EXTICR1-4: port routed to each EXTI line, 4 bits per line */
+    uint32_t                exti_imr;                       /**< EXTI interrupt mask register */
+    uint32_t                exti_rtsr;                      /**< EXTI rising trigger selection register */
+    uint32_t                exti_ftsr;                      /**< EXTI falling trigger selection register */
+    uint32_t                line_interrupts[16];            /**< Interrupts taken per EXTI line since boot (wraps) */
+    uint32_t                handler_count;                  /**< Registered handlers, including those not listed */
+    dmgpio_diag_handler_t   handlers[DMGPIO_DIAG_HANDLERS]; /**< First DMGPIO_DIAG_HANDLERS registrations */
+} dmgpio_diagnostics_t;
+
 #endif /* DMGPIO_TYPES_H */
@@ -23,6 +23,88 @@
  */
 #define DMGPIO_WRITE_BUF_SIZE   16
 
+/**
+ * @brief Size of the pin-state content in dmgpio_data_format_raw (little-endian mask).
+ */
+#define DMGPIO_RAW_DATA_SIZE    sizeof(dmgpio_pins_mask_t)
+
+/**
+ * @brief Content sizes of a bus wider than 16 bits: "0x%08X" and the
+ *        4-byte little-endian value.
+ */
+#define DMGPIO_WIDE_STATE_STR_LEN   10
+#define DMGPIO_WIDE_RAW_DATA_SIZE   sizeof(uint32_t)
+
+/**
+ * @brief Longest accepted debounce window (1 s).
+ */
+#define DMGPIO_DEBOUNCE_US_MAX  1000000UL
+
+/**
+ * @brief Highest accepted interrupt rate limit (interrupts per second).
+ */
+#define DMGPIO_RATE_LIMIT_MAX   1000000UL
+
+/**
+ * @brief Number of events buffered per device in dmgpio_data_format_events
+ *        (must be a power of two).
+ */
+#define DMGPIO_EVENT_QUEUE_SIZE 32U
+
+/**
+ * @brief Size of the text of the diagnostics device; longer dumps are cut.
+ */
+#define DMGPIO_DIAG_TEXT_SIZE   4096U
+
+/**
+ * @brief Edge events waiting to be read from a device.
+ *
+ * Filled by event_queue_handler() (the single producer, running in the
+ * EXTI ISR or the deferred-interrupt worker) and drained by _read (the
+ * single consumer).  head/tail run freely and are masked on access.
+ */
+typedef struct
+{
+    uint32_t        head;       /**< Next slot to write (producer) */
+    uint32_t        tail;       /**< Next slot to read (consumer) */
+    uint32_t        overflows;  /**< Events dropped because the queue was full (atomic) */
+    dmgpio_event_t  events[DMGPIO_EVENT_QUEUE_SIZE];
+} dmgpio_event_queue_t;
+
+/**
+ * @brief Last snapshot of the diagnostics device and its text.
+ *
+ * A read at offset 0 takes a new snapshot; reads at higher offsets return
+ * the rest of the same text, so a reader that needs several calls still
+ * sees one consistent dump.
+ */
+typedef struct
+{
+    dmgpio_diagnostics_t snapshot;                  /**< Port layer state */
+    size_t               length;                    /**< Bytes of text used */
+    char                 text[DMGPIO_DIAG_TEXT_SIZE];
+} dmgpio_diag_dump_t;
+
+/**
+ * @brief Value mapping of a bus device (bus=), built once at creation.
+ *
+ * The pins of the bus ports are seen as one word, slot k in bits 16k to
+ * 16k+15, and values are converted four bits at a time: scatter maps each
+ * nibble of a value to the bits of that word it drives high, gather maps
+ * each nibble of the word to the value bits it sets.  A conversion is then
+ * one table lookup per nibble whatever the pin order.
+ */
+typedef struct
+{
+    size_t              port_count;                         /**< Ports spanned by the bus */
+    dmgpio_port_t       ports[DMGPIO_BUS_MAX_PORTS];        /**< Port of each slot; ports[0] is config.port */
+    dmgpio_pins_mask_t  pins[DMGPIO_BUS_MAX_PORTS];         /**< Bus pins of each slot */
+    uint32_t            value_nibbles;                      /**< (bus_width + 3) / 4 */
+    uint64_t            scatter[DMGPIO_BUS_MAX_WIDTH / 4U][16];     /**< [value nibble][nibble value] -> pins word */
+    uint32_t            gather[4U * DMGPIO_BUS_MAX_PORTS][16];      /**< [pins word nibble][nibble value] -> value bits */
+    dmgpio_port_image_t direction[2][DMGPIO_BUS_MAX_PORTS];        /**< MODER-only images: [0] input, [1] output */
+} dmgpio_bus_map_t;
+
 /**
  * @brief DMDRVI context structure
  */
@@ -31,6 +113,13 @@ struct dmdrvi_context
     uint32_t        magic;  /**< Magic number for validation */
     dmgpio_config_t config; /**< GPIO configuration */
     char           *interrupt_handler_name; /**< dmhaman handler name (NULL = not used) */
+    dmgpio_data_format_t data_format;       /**< Format used by _read/_write (atomic: read_events watches it) */
+    dmgpio_event_queue_t *event_queue;      /**< Allocated on the first switch to events, kept until _free */
+    uint32_t        read_timeout_ms;        /**< Event read timeout (0 = non-blocking) */
+    uint32_t        configured;             /**< Non-zero once the pins are configured */
+    dmgpio_device_stats_t stats;            /**< Usage counters (dropped events and counter_hz are filled on read) */
+    dmgpio_diag_dump_t *diag;               /**< Set only on the diagnostics device (diagnostics=1) */
+    dmgpio_bus_map_t   *bus;                /**< Set only on bus devices (bus=) */
 };
 
 static int is_valid_context(dmdrvi_context_t context)
@@ -44,6 +133,12 @@ static int is_valid_context(dmdrvi_context_t context)
  * Packs port/pins/state into a dmgpio_interrupt_params_t and calls
  * dmhaman_call_handler() so that any module that registered a handler
  * under the configured name receives the interrupt notification.
+ *
+ * The handler is looked up by name on every interrupt.  dmhaman does not
+ * expose a way to resolve a name once or to be notified when the providing
+ * module unloads, so a resolved function pointer cannot be cached safely
+ * here.  High-rate inputs should register a function directly with
+ * dmgpio_ioctl_cmd_set_interrupt_handler, which involves no lookup.
  */
 static void dmhaman_interrupt_handler(void *user_ptr, dmgpio_port_t port,
                                        dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
@@ -56,6 +151,62 @@ static void dmhaman_interrupt_handler(void *user_ptr, dmgpio_port_t port,
     dmhaman_call_handler(ctx->interrupt_handler_name, &params);
 }
 
+/**
+ * @brief Internal port interrupt handler that appends an event to a device queue.
+ *
+ * Registered with the queue itself as user pointer, so it can be removed
+ * without touching handlers registered for the context.  A full queue
+ * drops the new event; readers see the gap through the overflow count.
+ */
+static void event_queue_handler(void *user_ptr, dmgpio_port_t port,
+                                dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    dmgpio_event_queue_t *queue = (dmgpio_event_queue_t *)user_ptr;
+    uint32_t head = queue->head;
+    if (head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) >= DMGPIO_EVENT_QUEUE_SIZE)
+    {
+        __atomic_fetch_add(&queue->overflows, 1U, __ATOMIC_RELAXED);
+        return;
+    }
+    dmgpio_event_t *event = &queue->events[head & (DMGPIO_EVENT_QUEUE_SIZE - 1U)];
+    dmgpio_port_read_event_timestamp(&event->timestamp);
+    event->params.port  = port;
+    event->params.pins  = pins;
+    event->params.state = state;
+    __atomic_store_n(&queue->head, head + 1U, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Internal port interrupt handler that counts the interrupts of a
+ *        device and the latency of their dispatch.
+ *
+ * Registered ahead of the other handlers of the device, so the latency is
+ * the time from the ISR entry to the first of them (for deferred devices,
+ * including the time spent in the queue).  The EXTI ISR can preempt the
+ * worker dispatching the same port, so the counters are updated atomically.
+ */
+static void stats_interrupt_handler(void *user_ptr, dmgpio_port_t port,
+                                    dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    (void)port; (void)pins; (void)state;
+    dmdrvi_context_t ctx = (dmdrvi_context_t)user_ptr;
+    uint32_t now   = 0U;
+    uint32_t entry = 0U;
+    dmgpio_port_read_cycle_counter(&now);
+    dmgpio_port_read_event_timestamp(&entry);
+
+    uint32_t latency = now - entry;
+    __atomic_fetch_add(&ctx->stats.interrupts, 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ctx->stats.latency[(latency != 0U) ? 31U - (uint32_t)__builtin_clz(latency) : 0U],
+                       1U, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&ctx->stats.latency_max, __ATOMIC_RELAXED);
+    while (latency > max &&
+           !__atomic_compare_exchange_n(&ctx->stats.latency_max, &max, latency, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
 /* ---- String helpers ---- */
 
 static const char *mode_to_string(dmgpio_mode_t mode)
@@ -174,6 +325,13 @@ static dmgpio_int_trigger_t string_to_interrupt_trigger(const char *s)
     return dmgpio_int_trigger_off;
 }
 
+static dmgpio_int_dispatch_t string_to_interrupt_dispatch(const char *s)
+{
+    if (s != NULL && strcmp(s, "deferred") == 0)
+        return dmgpio_int_dispatch_deferred;
+    return dmgpio_int_dispatch_immediate;
+}
+
 static int string_to_port(const char *s, dmgpio_port_t *out_port)
 {
     if (s != NULL && s[0] >= 'A' && s[0] <= 'K' && s[1] == '\0')
@@ -197,16 +355,15 @@ static const char *port_to_string(dmgpio_port_t port)
 /* ---- Configuration helpers ---- */
 
 /**
- * @brief Parse a decimal or hex (0x-prefixed) unsigned integer string.
+ * @brief Parse a decimal or hex (0x-prefixed) unsigned integer string of
+ *        at most @p max.
  *
  * @param s       Null-terminated input string (must not be NULL).
+ * @param max     Largest accepted value (up to 0xFFFFFFFF).
  * @param out_val Receives the parsed value on success.
- * @return 0 on success, -1 on parse error or overflow (value > ULONG_MAX/UINT16_MAX).
- *
- * Note: overflow is detected conservatively — parsing stops with an error if the
- * accumulated value would exceed 0xFFFF, which is sufficient for pin-mask values.
+ * @return 0 on success, -1 on parse error or a value above @p max.
  */
-static int parse_uint(const char *s, unsigned long *out_val)
+static int parse_uint_max(const char *s, unsigned long max, unsigned long *out_val)
 {
     if (s == NULL || *s == '\0') return -1;
 
@@ -224,7 +381,7 @@ static int parse_uint(const char *s, unsigned long *out_val)
             else if (c >= 'a' && c <= 'f') digit = (unsigned long)(c - 'a' + 10);
             else if (c >= 'A' && c <= 'F') digit = (unsigned long)(c - 'A' + 10);
             else return -1;
-            if (v > (0xFFFFUL >> 4U)) return -1; /* overflow guard */
+            if (digit > max || v > ((max - digit) >> 4U)) return -1; /* overflow guard */
             v = (v << 4U) | digit;
         }
         *out_val = v;
@@ -239,14 +396,273 @@ static int parse_uint(const char *s, unsigned long *out_val)
     {
         unsigned char c = (unsigned char)*p;
         if (c < '0' || c > '9') return -1;
-        if (v > (0xFFFFUL / 10U)) return -1; /* overflow guard */
-        v = v * 10U + (unsigned long)(c - '0');
-        if (v > 0xFFFFUL) return -1;
+        unsigned long digit = (unsigned long)(c - '0');
+        if (digit > max || v > (max - digit) / 10U) return -1; /* overflow guard */
+        v = v * 10U + digit;
     }
     *out_val = v;
     return 0;
 }
 
+/**
+ * @brief Parse an unsigned integer of at most 0xFFFF, which is sufficient
+ *        for pin numbers and pin-mask values (see parse_uint_max()).
+ */
+static int parse_uint(const char *s, unsigned long *out_val)
+{
+    return parse_uint_max(s, 0xFFFFUL, out_val);
+}
+
+/**
+ * @brief Size of the stack buffer tried first when serialising the INI.
+ *        Per-device configs fit; only large board files need the heap.
+ */
+#define DMGPIO_INI_STACK_BUF_SIZE   256
+
+/**
+ * @brief Size of a buffer holding a configuration section name.
+ */
+#define DMGPIO_SECTION_BUF_SIZE     64
+
+/**
+ * @brief Number of keys of one section kept by split_next_section().
+ */
+#define DMGPIO_SECTION_MAX_KEYS     16
+
+/**
+ * @brief Source of the configuration keys of one section.
+ *
+ * Either looked up in the INI context (@c ini set) or taken from a section
+ * already split out of the serialised INI by split_next_section(), which
+ * saves a dmini lookup per key when a whole board file is processed.
+ */
+typedef struct
+{
+    dmini_context_t ini;                            /**< Look keys up here, or NULL to use the split keys */
+    const char     *name;                           /**< Section name */
+    size_t          key_count;                      /**< Number of split keys */
+    const char     *keys[DMGPIO_SECTION_MAX_KEYS];  /**< Split key names */
+    const char     *values[DMGPIO_SECTION_MAX_KEYS];/**< Split key values */
+} config_section_t;
+
+/**
+ * @brief Read a key of a configuration section.
+ *
+ * @return The value, or @p default_value if the key is not present.
+ */
+static const char *config_get(const config_section_t *s, const char *key, const char *default_value)
+{
+    if (s->ini != NULL)
+        return dmini_get_string(s->ini, s->name, key, default_value);
+
+    for (size_t i = 0; i < s->key_count; i++)
+    {
+        if (strcmp(s->keys[i], key) == 0)
+            return s->values[i];
+    }
+    return default_value;
+}
+
+/**
+ * @brief Check whether a section configures a GPIO device: any section
+ *        except [main] that assigns 'pin', 'port', 'mode', 'bus' or
+ *        'diagnostics'.
+ */
+static int is_gpio_section(const config_section_t *s)
+{
+    return strcmp(s->name, "main") != 0 &&
+           (config_get(s, "pin", NULL) != NULL ||
+            config_get(s, "port", NULL) != NULL ||
+            config_get(s, "mode", NULL) != NULL ||
+            config_get(s, "bus", NULL) != NULL ||
+            config_get(s, "diagnostics", NULL) != NULL);
+}
+
+/**
+ * @brief Check whether a section asks for the diagnostics device.
+ */
+static int is_diagnostics_section(const config_section_t *s)
+{
+    return strcmp(config_get(s, "diagnostics", "0"), "1") == 0;
+}
+
+/**
+ * @brief Strip leading and trailing blanks of [@p start, @p end) in place.
+ *
+ * @return The first non-blank character, NUL-terminated after the last one.
+ */
+static char *trim_in_place(char *start, char *end)
+{
+    while (start < end && (*start == ' ' || *start == '\t'))
+        start++;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+    *end = '\0';
+    return start;
+}
+
+/**
+ * @brief Split the next section out of a serialised INI.
+ *
+ * The text is modified in place: the section name, keys and values are
+ * NUL-terminated where they stand and @p out points into it, so @p out is
+ * only valid while the text is.  Scanning resumes at @p *cursor and stops
+ * at the next section header, so repeated calls walk every section of the
+ * file in a single pass.  A section with more than DMGPIO_SECTION_MAX_KEYS
+ * keys falls back to looking its keys up in @p ini.
+ *
+ * @return 0 with @p out filled, or -1 if there is no section left.
+ */
+static int split_next_section(char **cursor, dmini_context_t ini, config_section_t *out)
+{
+    char *line = *cursor;
+    out->name = NULL;
+
+    while (*line != '\0')
+    {
+        char *end  = strchr(line, '\n');
+        char *next = (end != NULL) ? end + 1 : line + strlen(line);
+        if (end == NULL)
+            end = next;
+
+        char *p = line;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if (p < end && *p == '[')
+        {
+            if (out->name != NULL)
+                break;      /* start of the following section */
+
+            char *name_end = memchr(p + 1, ']', (size_t)(end - p - 1));
+            if (name_end != NULL)
+            {
+                *name_end      = '\0';
+                out->name      = p + 1;
+                out->ini       = NULL;
+                out->key_count = 0;
+            }
+        }
+        else if (out->name != NULL && p < end && *p != ';' && *p != '#')
+        {
+            char *eq = memchr(p, '=', (size_t)(end - p));
+            if (eq != NULL)
+            {
+                if (out->key_count < DMGPIO_SECTION_MAX_KEYS)
+                {
+                    out->keys[out->key_count]   = trim_in_place(p, eq);
+                    out->values[out->key_count] = trim_in_place(eq + 1, end);
+                    out->key_count++;
+                }
+                else
+                {
+                    out->ini = ini;
+                }
+            }
+        }
+        line = next;
+    }
+
+    *cursor = line;
+    return (out->name != NULL) ? 0 : -1;
+}
+
+/**
+ * @brief Serialise an INI context, into @p stack_buf when it fits.
+ *
+ * @return The NUL-terminated text (@p stack_buf or a heap buffer to be
+ *         released with release_ini_string), or NULL if the INI is empty or
+ *         cannot be serialised.
+ */
+static char *generate_ini_string(dmini_context_t ini, char *stack_buf, size_t stack_buf_sz)
+{
+    /* dmini_generate_string follows snprintf convention: it returns the
+     * number of characters needed, NOT including the null terminator. */
+    int needed = dmini_generate_string(ini, stack_buf, stack_buf_sz);
+    if (needed <= 1)
+        return NULL;
+
+    char *ini_str = stack_buf;
+    if ((size_t)needed >= stack_buf_sz)
+    {
+        ini_str = (char *)Dmod_Malloc((size_t)needed + 1);
+        if (ini_str == NULL)
+            return NULL;
+        if (dmini_generate_string(ini, ini_str, (size_t)needed + 1) <= 0)
+        {
+            Dmod_Free(ini_str);
+            return NULL;
+        }
+    }
+    ini_str[needed] = '\0'; /* ensure termination regardless of dmini API behaviour */
+    return ini_str;
+}
+
+static void release_ini_string(char *ini_str, char *stack_buf)
+{
+    if (ini_str != stack_buf)
+        Dmod_Free(ini_str);
+}
+
+/**
+ * @brief Detect which INI section holds the GPIO configuration.
+ *
+ * The driver supports two config file layouts:
+ *   1. Standard: a [dmgpio] section (e.g. examples/config.ini).
+ *   2. Board / device-named: a section whose name is the device label
+ *      (e.g. [led_ld1], [button_b1] in board config files).
+ *
+ * Detection strategy:
+ *   a) If [dmgpio] contains a 'pin' or 'port' key → use "dmgpio".
+ *   b) Otherwise serialise the INI once and walk its sections for the
+ *      first named section (skipping [main]) that assigns 'pin', 'port',
+ *      'mode', 'bus' or 'diagnostics'.  Copy its name into section_buf and
+ *      return it.
+ *   c) Fall back to "dmgpio" so the caller produces a meaningful error.
+ *
+ * The keys are recognised in the serialised text itself, so the scan costs
+ * one pass over the file and no per-section lookups.  dmgpio_dmdrvi_create
+ * calls this once and uses the result for both the configuration and the
+ * device name.
+ *
+ * @param ini            INI context to inspect.
+ * @param section_buf    Caller-supplied buffer that receives the name when
+ *                       a non-"dmgpio" section is chosen.
+ * @param section_buf_sz Size of section_buf in bytes.
+ * @return Pointer to the chosen section name (either the literal "dmgpio"
+ *         or section_buf).
+ */
+static const char *detect_config_section(dmini_context_t ini,
+                                          char *section_buf, size_t section_buf_sz)
+{
+    /* Fast path – standard [dmgpio] section present */
+    if (dmini_has_key(ini, "dmgpio", "pin") || dmini_has_key(ini, "dmgpio", "port"))
+        return "dmgpio";
+
+    /* Slow path – serialise the INI and scan it */
+    char  stack_buf[DMGPIO_INI_STACK_BUF_SIZE];
+    char *ini_str = generate_ini_string(ini, stack_buf, sizeof(stack_buf));
+    if (ini_str == NULL)
+        return "dmgpio";
+
+    const char      *result = "dmgpio";
+    char            *cursor = ini_str;
+    config_section_t s;
+    while (split_next_section(&cursor, ini, &s) == 0)
+    {
+        size_t name_len = strlen(s.name);
+        if (name_len > 0 && name_len < section_buf_sz && is_gpio_section(&s))
+        {
+            memcpy(section_buf, s.name, name_len + 1);
+            result = section_buf;
+            break;
+        }
+    }
+
+    release_ini_string(ini_str, stack_buf);
+    return result;
+}
+
 /**
  * @brief Parse the section name to resolve port and pins configuration.
  *
@@ -254,11 +670,11 @@ static int parse_uint(const char *s, unsigned long *out_val)
  *   1. Combined: pin=PA5   (sets port=A, pins=1<<5)
  *   2. Separate: port=A / pins=0x0020  (decimal or hex bitmask)
  */
-static int read_port_and_pins(dmini_context_t ini, const char *section,
+static int read_port_and_pins(const config_section_t *s,
                                dmgpio_port_t *out_port, dmgpio_pins_mask_t *out_pins)
 {
     /* Try combined "pin=PA5" or "pin=A5" format first */
-    const char *pin_str = dmini_get_string(ini, section, "pin", NULL);
+    const char *pin_str = config_get(s, "pin", NULL);
     if (pin_str != NULL)
     {
         /* Accept optional leading 'P' (e.g. "PA5" or "A5") */
@@ -271,7 +687,7 @@ static int read_port_and_pins(dmini_context_t ini, const char *section,
             if (parse_uint(port_ptr + 1, &pin_num) != 0 || pin_num > 15)
             {
                 DMOD_LOG_ERROR("Invalid pin in '%s' config 'pin=%s' (expected PA0-PK15 or A0-K15)\n",
-                    section, pin_str);
+                    s->name, pin_str);
                 return -EINVAL;
             }
             *out_port = (dmgpio_port_t)(port_ptr[0] - 'A');
@@ -281,23 +697,23 @@ static int read_port_and_pins(dmini_context_t ini, const char *section,
     }
 
     /* Fall back to separate port= and pins= keys */
-    const char *port_str = dmini_get_string(ini, section, "port", NULL);
+    const char *port_str = config_get(s, "port", NULL);
     if (string_to_port(port_str, out_port) != 0)
     {
-        DMOD_LOG_ERROR("Invalid or missing 'port' in [%s] config (expected A-K)\n", section);
+        DMOD_LOG_ERROR("Invalid or missing 'port' in [%s] config (expected A-K)\n", s->name);
         return -EINVAL;
     }
 
-    const char *pins_str = dmini_get_string(ini, section, "pins", NULL);
+    const char *pins_str = config_get(s, "pins", NULL);
     if (pins_str == NULL)
     {
-        DMOD_LOG_ERROR("Missing 'pins' in [%s] config\n", section);
+        DMOD_LOG_ERROR("Missing 'pins' in [%s] config\n", s->name);
         return -EINVAL;
     }
     unsigned long pins_val;
     if (parse_uint(pins_str, &pins_val) != 0 || pins_val < 1 || pins_val > 0xFFFF)
     {
-        DMOD_LOG_ERROR("Invalid 'pins' in [%s] config (must be 1-0xFFFF bitmask)\n", section);
+        DMOD_LOG_ERROR("Invalid 'pins' in [%s] config (must be 1-0xFFFF bitmask)\n", s->name);
         return -EINVAL;
     }
     *out_pins = (dmgpio_pins_mask_t)pins_val;
@@ -305,127 +721,162 @@ static int read_port_and_pins(dmini_context_t ini, const char *section,
 }
 
 /**
- * @brief Detect which INI section holds the GPIO configuration.
+ * @brief Parse a pin name such as "PB5" or "B5".
  *
- * The driver supports two config file layouts:
- *   1. Standard: a [dmgpio] section (e.g. examples/config.ini).
- *   2. Board / device-named: a section whose name is the device label
- *      (e.g. [led_ld1], [button_b1] in board config files).
+ * @return 0 on success, -1 if @p str is not PA0-PK15 or A0-K15.
+ */
+static int string_to_pin(const char *str, dmgpio_port_t *out_port, dmgpio_pin_t *out_pin)
+{
+    if (str[0] == 'P') str++;
+    unsigned long pin_num;
+    if (str[0] < 'A' || str[0] > 'K' || parse_uint(str + 1, &pin_num) != 0 || pin_num > 15)
+        return -1;
+    *out_port = (dmgpio_port_t)(str[0] - 'A');
+    *out_pin  = (dmgpio_pin_t)pin_num;
+    return 0;
+}
+
+/**
+ * @brief Split the pins of a device by port, in order of first use.
  *
- * Detection strategy:
- *   a) If [dmgpio] contains a 'pin' or 'port' key → use "dmgpio".
- *   b) Otherwise serialise the INI to a temporary string and scan for
- *      the first named section (skipping [main]) that contains 'pin',
- *      'port', or 'mode'.  Copy its name into section_buf and return it.
- *   c) Fall back to "dmgpio" so the caller produces a meaningful error.
+ * A device that is not a bus, or a bus on one port, gives config.port and
+ * config.pins only; otherwise ports[0] is still config.port.
  *
- * @param ini            INI context to inspect.
- * @param section_buf    Caller-supplied buffer that receives the name when
- *                       a non-"dmgpio" section is chosen.
- * @param section_buf_sz Size of section_buf in bytes.
- * @return Pointer to the chosen section name (either the literal "dmgpio"
- *         or section_buf).
+ * @return Number of entries written (1 to DMGPIO_BUS_MAX_PORTS).
  */
-static const char *detect_config_section(dmini_context_t ini,
-                                          char *section_buf, size_t section_buf_sz)
+static size_t split_pins_by_port(const dmgpio_config_t *c, dmgpio_port_t ports[DMGPIO_BUS_MAX_PORTS],
+                                 dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS])
 {
-    /* Fast path – standard [dmgpio] section present */
-    if (dmini_has_key(ini, "dmgpio", "pin") || dmini_has_key(ini, "dmgpio", "port"))
-        return "dmgpio";
-
-    /* Slow path – serialise the INI and scan for the first usable section */
-    int needed = dmini_generate_string(ini, NULL, 0);
-    if (needed <= 1)
-        return "dmgpio";
-
-    /* dmini_generate_string follows snprintf convention: the first call returns
-     * the number of characters that would be written, NOT including the null
-     * terminator.  Allocate one extra byte so the null terminator always fits
-     * and the scanning loop below is guaranteed to find it within the buffer. */
-    char *ini_str = (char *)Dmod_Malloc((size_t)needed + 1);
-    if (ini_str == NULL)
-        return "dmgpio";
-
-    if (dmini_generate_string(ini, ini_str, (size_t)needed + 1) <= 0)
+    size_t count = 1;
+    ports[0] = c->port;
+    pins[0]  = c->pins;
+    for (uint32_t bit = 0; bit < c->bus_width; bit++)
     {
-        Dmod_Free(ini_str);
-        return "dmgpio";
+        dmgpio_port_t port = (dmgpio_port_t)(c->bus_pins[bit] >> 4U);
+        size_t slot = 0;
+        while (slot < count && ports[slot] != port)
+            slot++;
+        if (slot == count)
+        {
+            if (count == DMGPIO_BUS_MAX_PORTS)
+                break;
+            ports[count]  = port;
+            pins[count++] = 0U;
+        }
+        if (slot != 0U)
+            pins[slot] |= (dmgpio_pins_mask_t)(1U << (c->bus_pins[bit] & 0x0FU));
     }
-    ini_str[needed] = '\0'; /* belt-and-suspenders: ensure the buffer is always
-                             * null-terminated regardless of dmini API behaviour */
+    return count;
+}
+
+/**
+ * @brief Ports spanned by the pins of @p c, bit N = port N.
+ */
+static uint32_t spanned_ports(const dmgpio_config_t *c)
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    uint32_t           mask = 0;
+    for (size_t p = split_pins_by_port(c, ports, pins); p > 0U; p--)
+        mask |= 1UL << ports[p - 1U];
+    return mask;
+}
 
-    const char *result = "dmgpio";
-    char *p = ini_str;
-    while (*p != '\0')
+/**
+ * @brief Parse 'bus=PB0,PB1,...', the pins of a bus device in value bit
+ *        order (least significant first), into port, pins and bus_pins.
+ *
+ * The pins may span up to DMGPIO_BUS_MAX_PORTS ports; port and pins then
+ * describe the port of the first pin and the rest is only in bus_pins.
+ *
+ * @return 0 on success, -EINVAL on an invalid list.
+ */
+static int read_bus_pins(const config_section_t *s, const char *list, dmgpio_config_t *c)
+{
+    dmgpio_port_t ports[DMGPIO_BUS_MAX_PORTS];
+    size_t        port_count = 0;
+    c->pins      = 0;
+    c->bus_width = 0;
+    for (const char *p = list; ; )
     {
-        if (*p == '[')
+        const char *end = p;
+        while (*end != ',' && *end != '\0')
+            end++;
+
+        /* A pin name and its blanks fit easily; a longer item is invalid */
+        char          item[8] = "";
+        size_t        len     = (size_t)(end - p);
+        dmgpio_port_t port;
+        dmgpio_pin_t  pin;
+        if (len < sizeof(item))
+            memcpy(item, p, len);
+        if (len >= sizeof(item) || string_to_pin(trim_in_place(item, item + len), &port, &pin) != 0)
         {
-            char *name_start = p + 1;
-            char *name_end   = name_start;
-            while (*name_end != '\0' && *name_end != ']' &&
-                   *name_end != '\n'  && *name_end != '\r')
-                name_end++;
-
-            if (*name_end == ']')
-            {
-                size_t name_len = (size_t)(name_end - name_start);
-                if (name_len > 0 && name_len < section_buf_sz)
-                {
-                    /* Copy to section_buf so we have a null-terminated name */
-                    memcpy(section_buf, name_start, name_len);
-                    section_buf[name_len] = '\0';
-
-                    if (strcmp(section_buf, "main") != 0 &&
-                        (dmini_has_key(ini, section_buf, "pin")  ||
-                         dmini_has_key(ini, section_buf, "port") ||
-                         dmini_has_key(ini, section_buf, "mode")))
-                    {
-                        result = section_buf;
-                        break;
-                    }
-                }
-            }
+            DMOD_LOG_ERROR("Invalid pin in [%s] config 'bus=%s' (expected a list of PA0-PK15)\n",
+                s->name, list);
+            return -EINVAL;
         }
-        p++;
-    }
+        size_t slot = 0;
+        while (slot < port_count && ports[slot] != port)
+            slot++;
+        int duplicate = 0;
+        for (uint32_t bit = 0; bit < c->bus_width; bit++)
+            duplicate |= (c->bus_pins[bit] == DMGPIO_BUS_PIN(port, pin));
+        if (c->bus_width == DMGPIO_BUS_MAX_WIDTH || duplicate ||
+            (slot == port_count && port_count == DMGPIO_BUS_MAX_PORTS))
+        {
+            DMOD_LOG_ERROR("Invalid 'bus' in [%s] config (1-%u distinct pins of at most %u ports)\n",
+                s->name, (unsigned)DMGPIO_BUS_MAX_WIDTH, (unsigned)DMGPIO_BUS_MAX_PORTS);
+            return -EINVAL;
+        }
+        if (slot == port_count)
+            ports[port_count++] = port;
+        if (slot == 0U)
+        {
+            c->port  = port;
+            c->pins |= (dmgpio_pins_mask_t)(1U << pin);
+        }
+        c->bus_pins[c->bus_width++] = DMGPIO_BUS_PIN(port, pin);
 
-    Dmod_Free(ini_str);
-    return result;
+        if (*end == '\0')
+            return 0;
+        p = end + 1;
+    }
 }
 
-static int read_config_parameters(dmdrvi_context_t ctx, dmini_context_t ini)
+static int read_config_parameters(dmdrvi_context_t ctx, const config_section_t *s)
 {
-    char section_buf[64];
-    const char *section = detect_config_section(ini, section_buf, sizeof(section_buf));
-
-    if (read_port_and_pins(ini, section, &ctx->config.port, &ctx->config.pins) != 0)
+    const char *bus = config_get(s, "bus", NULL);
+    if (bus != NULL ? read_bus_pins(s, bus, &ctx->config) != 0
+                    : read_port_and_pins(s, &ctx->config.port, &ctx->config.pins) != 0)
         return -EINVAL;
 
     /* Mode is mandatory */
-    const char *mode_str = dmini_get_string(ini, section, "mode", NULL);
+    const char *mode_str = config_get(s, "mode", NULL);
     if (string_to_mode(mode_str, &ctx->config.mode) != 0)
     {
         DMOD_LOG_ERROR("Invalid or missing 'mode' in [%s] config (expected input/output/alternate)\n",
-            section);
+            s->name);
         return -EINVAL;
     }
 
-    ctx->config.pull             = string_to_pull(dmini_get_string(ini, section, "pull", "none"));
-    ctx->config.speed            = string_to_speed(dmini_get_string(ini, section, "speed", "default"));
-    ctx->config.output_circuit   = string_to_output_circuit(dmini_get_string(ini, section, "output_circuit", "default"));
-    ctx->config.current          = string_to_current(dmini_get_string(ini, section, "current", "default"));
-    ctx->config.protection       = string_to_protection(dmini_get_string(ini, section, "protection", "dont_unlock"));
-    ctx->config.interrupt_trigger = string_to_interrupt_trigger(dmini_get_string(ini, section, "interrupt_trigger", "off"));
+    ctx->config.pull             = string_to_pull(config_get(s, "pull", "none"));
+    ctx->config.speed            = string_to_speed(config_get(s, "speed", "default"));
+    ctx->config.output_circuit   = string_to_output_circuit(config_get(s, "output_circuit", "default"));
+    ctx->config.current          = string_to_current(config_get(s, "current", "default"));
+    ctx->config.protection       = string_to_protection(config_get(s, "protection", "dont_unlock"));
+    ctx->config.interrupt_trigger = string_to_interrupt_trigger(config_get(s, "interrupt_trigger", "off"));
+    ctx->config.interrupt_dispatch = string_to_interrupt_dispatch(config_get(s, "interrupt_dispatch", "immediate"));
     ctx->config.interrupt_handler = NULL; /* set programmatically or via ioctl */
 
     /* Alternate function number (0-15), used when mode=alternate */
-    const char *af_str = dmini_get_string(ini, section, "alternate_function", NULL);
+    const char *af_str = config_get(s, "alternate_function", NULL);
     if (af_str != NULL)
     {
         unsigned long af_val;
         if (parse_uint(af_str, &af_val) != 0 || af_val > 15)
         {
-            DMOD_LOG_ERROR("Invalid 'alternate_function' in [%s] config (must be 0-15)\n", section);
+            DMOD_LOG_ERROR("Invalid 'alternate_function' in [%s] config (must be 0-15)\n", s->name);
             return -EINVAL;
         }
         ctx->config.alternate_function = (uint8_t)af_val;
@@ -435,31 +886,117 @@ static int read_config_parameters(dmdrvi_context_t ctx, dmini_context_t ini)
         ctx->config.alternate_function = 0;
     }
 
-    const char *handler_name = dmini_get_string(ini, section, "interrupt_handler", NULL);
-    ctx->interrupt_handler_name = (handler_name != NULL) ? Dmod_StrDup(handler_name) : NULL;
-
-    return 0;
-}
-
-static int configure(dmdrvi_context_t ctx)
-{
-    const dmgpio_config_t *c = &ctx->config;
-    int ret;
+    /* lazy=1 defers the clock and register setup to the first access */
+    const char *lazy_str = config_get(s, "lazy", NULL);
+    if (lazy_str != NULL)
+    {
+        unsigned long lazy_val;
+        if (parse_uint(lazy_str, &lazy_val) != 0 || lazy_val > 1)
+        {
+            DMOD_LOG_ERROR("Invalid 'lazy' in [%s] config (must be 0 or 1)\n", s->name);
+            return -EINVAL;
+        }
+        ctx->config.lazy = (lazy_val != 0);
+    }
+    else
+    {
+        ctx->config.lazy = false;
+    }
 
-    ret = dmgpio_port_set_power(c->port, 1);
-    if (ret != 0)
+    /* interrupt_stats=1 adds the counting handler ahead of the device's own */
+    const char *stats_str = config_get(s, "interrupt_stats", NULL);
+    if (stats_str != NULL)
     {
-        DMOD_LOG_ERROR("Failed to enable power for GPIO port %s\n", port_to_string(c->port));
-        return ret;
+        unsigned long stats_val;
+        if (parse_uint(stats_str, &stats_val) != 0 || stats_val > 1)
+        {
+            DMOD_LOG_ERROR("Invalid 'interrupt_stats' in [%s] config (must be 0 or 1)\n", s->name);
+            return -EINVAL;
+        }
+        ctx->config.interrupt_stats = (stats_val != 0);
+    }
+    else
+    {
+        ctx->config.interrupt_stats = false;
     }
 
-    ret = dmgpio_port_begin_configuration(c->port, c->pins);
-    if (ret != 0)
+    /* debounce_us masks the EXTI lines after an edge until the input settles */
+    const char *debounce_str = config_get(s, "debounce_us", NULL);
+    if (debounce_str != NULL)
     {
-        DMOD_LOG_ERROR("Failed to begin configuration for GPIO port %s pins 0x%04X\n",
-            port_to_string(c->port), (unsigned)c->pins);
-        return ret;
+        unsigned long debounce_val;
+        if (parse_uint_max(debounce_str, DMGPIO_DEBOUNCE_US_MAX, &debounce_val) != 0)
+        {
+            DMOD_LOG_ERROR("Invalid 'debounce_us' in [%s] config (must be 0-%lu)\n",
+                s->name, (unsigned long)DMGPIO_DEBOUNCE_US_MAX);
+            return -EINVAL;
+        }
+        ctx->config.debounce_us = (uint32_t)debounce_val;
+    }
+    else
+    {
+        ctx->config.debounce_us = 0;
+    }
+
+    /* max_interrupt_rate throttles a pin that raises interrupts faster */
+    const char *rate_str = config_get(s, "max_interrupt_rate", NULL);
+    if (rate_str != NULL)
+    {
+        unsigned long rate_val;
+        if (parse_uint_max(rate_str, DMGPIO_RATE_LIMIT_MAX, &rate_val) != 0)
+        {
+            DMOD_LOG_ERROR("Invalid 'max_interrupt_rate' in [%s] config (must be 0-%lu)\n",
+                s->name, (unsigned long)DMGPIO_RATE_LIMIT_MAX);
+            return -EINVAL;
+        }
+        ctx->config.max_interrupt_rate = (uint32_t)rate_val;
     }
+    else
+    {
+        ctx->config.max_interrupt_rate = 0;
+    }
+
+    /* A window is only closed by the worker, so without one the line
+     * would stay masked after its first edge */
+    if (ctx->config.debounce_us != 0U && ctx->config.interrupt_dispatch != dmgpio_int_dispatch_deferred)
+    {
+        DMOD_LOG_ERROR("Invalid 'debounce_us' in [%s] config (requires 'interrupt_dispatch=deferred')\n",
+            s->name);
+        return -EINVAL;
+    }
+
+    /* Likewise a throttled line is only polled and unmasked by the worker */
+    if (ctx->config.max_interrupt_rate != 0U && ctx->config.interrupt_dispatch != dmgpio_int_dispatch_deferred)
+    {
+        DMOD_LOG_ERROR("Invalid 'max_interrupt_rate' in [%s] config (requires 'interrupt_dispatch=deferred')\n",
+            s->name);
+        return -EINVAL;
+    }
+
+    /* The interrupt plumbing is per port; a bus spanning several ports
+     * is only ever read and written as a whole */
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    if (ctx->config.interrupt_trigger != dmgpio_int_trigger_off &&
+        split_pins_by_port(&ctx->config, ports, pins) > 1U)
+    {
+        DMOD_LOG_ERROR("Invalid 'interrupt_trigger' in [%s] config (not supported on a bus spanning several ports)\n",
+            s->name);
+        return -EINVAL;
+    }
+
+    const char *handler_name = config_get(s, "interrupt_handler", NULL);
+    ctx->interrupt_handler_name = (handler_name != NULL) ? Dmod_StrDup(handler_name) : NULL;
+
+    return 0;
+}
+
+/**
+ * @brief Apply the pin settings of @p c inside an open configuration session.
+ */
+static int apply_pin_settings(const dmgpio_config_t *c)
+{
+    int ret;
 
     if (c->protection == dmgpio_protection_unlock_protected_pins)
     {
@@ -530,6 +1067,35 @@ static int configure(dmdrvi_context_t ctx)
      * configured (e.g. the [led_ld1] section in board/stm32f746g-disco.ini). */
     if (c->interrupt_trigger != dmgpio_int_trigger_off)
     {
+        /* Deferral is a property of the whole port and is never switched
+         * back off here: other devices on the port may rely on it. */
+        if (c->interrupt_dispatch == dmgpio_int_dispatch_deferred)
+        {
+            ret = dmgpio_port_set_deferred_dispatch(c->port, 1);
+            if (ret != 0)
+            {
+                DMOD_LOG_ERROR("Failed to enable deferred interrupts for GPIO port %s\n",
+                    port_to_string(c->port));
+                return ret;
+            }
+        }
+
+        ret = dmgpio_port_set_debounce(c->port, c->pins, c->debounce_us);
+        if (ret != 0)
+        {
+            DMOD_LOG_ERROR("Failed to set debounce for GPIO port %s pins 0x%04X\n",
+                port_to_string(c->port), (unsigned)c->pins);
+            return ret;
+        }
+
+        ret = dmgpio_port_set_rate_limit(c->port, c->pins, c->max_interrupt_rate);
+        if (ret != 0)
+        {
+            DMOD_LOG_ERROR("Failed to set interrupt rate limit for GPIO port %s pins 0x%04X\n",
+                port_to_string(c->port), (unsigned)c->pins);
+            return ret;
+        }
+
         ret = dmgpio_port_set_interrupt_trigger(c->port, c->pins, c->interrupt_trigger);
         if (ret != 0)
         {
@@ -539,99 +1105,825 @@ static int configure(dmdrvi_context_t ctx)
         }
     }
 
-    ret = dmgpio_port_finish_configuration(c->port, c->pins);
-    if (ret != 0)
+    return 0;
+}
+
+/**
+ * @brief Read the interrupt trigger of every pin of @p c, port by port as
+ *        split_pins_by_port lists them, so undo_pin_settings can put them
+ *        back.  The EXTI is only read for devices with an interrupt
+ *        trigger, the same condition under which apply_pin_settings
+ *        touches it.
+ */
+static int save_interrupt_triggers(const dmgpio_config_t *c, uint8_t triggers[DMGPIO_BUS_MAX_WIDTH])
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    size_t             n = 0;
+    if (c->interrupt_trigger == dmgpio_int_trigger_off)
+        return 0;
+    for (size_t p = split_pins_by_port(c, ports, pins); p > 0U; p--)
+    {
+        for (dmgpio_pins_mask_t left = pins[p - 1U]; left != 0U; left &= (dmgpio_pins_mask_t)(left - 1U))
+        {
+            dmgpio_int_trigger_t trigger = dmgpio_int_trigger_off;
+            if (n == DMGPIO_BUS_MAX_WIDTH ||
+                dmgpio_port_read_interrupt_trigger(ports[p - 1U], (dmgpio_pins_mask_t)(left & -left), &trigger) != 0)
+            {
+                DMOD_LOG_ERROR("Failed to read interrupt trigger for GPIO port %s pins 0x%04X\n",
+                    port_to_string(ports[p - 1U]), (unsigned)pins[p - 1U]);
+                return -EIO;
+            }
+            triggers[n++] = (uint8_t)trigger;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Undo what apply_pin_settings staged for @p c in the open
+ *        configuration sessions of its ports.
+ *
+ * The register settings are dropped from the sessions; the EXTI, which is
+ * written directly, gets back the triggers read by save_interrupt_triggers
+ * and no debounce or rate limit.  Deferred dispatch stays on, as
+ * apply_pin_settings never switches it off.
+ */
+static void undo_pin_settings(const dmgpio_config_t *c, const uint8_t triggers[DMGPIO_BUS_MAX_WIDTH])
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    size_t             n = 0;
+    for (size_t p = split_pins_by_port(c, ports, pins); p > 0U; p--)
+    {
+        dmgpio_port_discard_configuration(ports[p - 1U], pins[p - 1U]);
+        if (c->interrupt_trigger == dmgpio_int_trigger_off)
+            continue;
+        dmgpio_port_set_debounce(ports[p - 1U], pins[p - 1U], 0U);
+        dmgpio_port_set_rate_limit(ports[p - 1U], pins[p - 1U], 0U);
+        for (dmgpio_pins_mask_t left = pins[p - 1U]; left != 0U; left &= (dmgpio_pins_mask_t)(left - 1U))
+            dmgpio_port_set_interrupt_trigger(ports[p - 1U], (dmgpio_pins_mask_t)(left & -left),
+                (dmgpio_int_trigger_t)triggers[n++]);
+    }
+}
+
+/**
+ * @brief Record a device as successfully configured.
+ */
+static void mark_configured(dmdrvi_context_t ctx)
+{
+    const dmgpio_config_t *c = &ctx->config;
+    __atomic_store_n(&ctx->configured, 1U, __ATOMIC_RELEASE);
+
+    DMOD_LOG_INFO("GPIO P%s[0x%04X] configured: mode=%s, pull=%s, speed=%s, circuit=%s\n",
+        port_to_string(c->port), (unsigned)c->pins,
+        mode_to_string(c->mode),
+        pull_to_string(c->pull),
+        speed_to_string(c->speed),
+        output_circuit_to_string(c->output_circuit));
+}
+
+/**
+ * @brief Power and configure the pins of @p c, which are all on c->port.
+ */
+static int configure_port(const dmgpio_config_t *c)
+{
+    int ret;
+
+    ret = dmgpio_port_set_power(c->port, 1);
+    if (ret != 0)
+    {
+        DMOD_LOG_ERROR("Failed to enable power for GPIO port %s\n", port_to_string(c->port));
+        return ret;
+    }
+
+    ret = dmgpio_port_begin_configuration(c->port, c->pins);
+    if (ret != 0)
+    {
+        DMOD_LOG_ERROR("Failed to begin configuration for GPIO port %s pins 0x%04X\n",
+            port_to_string(c->port), (unsigned)c->pins);
+        return ret;
+    }
+
+    /* The session is always finished, even after a failed setting, so the
+     * port does not stay in staging mode; whatever was applied is committed
+     * just as it would have been written directly. */
+    ret = apply_pin_settings(c);
+    int finish_ret = dmgpio_port_finish_configuration(c->port, c->pins);
+    if (ret != 0)
+        return ret;
+    if (finish_ret != 0)
+    {
+        DMOD_LOG_ERROR("Failed to finish configuration for GPIO port %s pins 0x%04X\n",
+            port_to_string(c->port), (unsigned)c->pins);
+        return finish_ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief Configure the pins of a device, one session per port it spans.
+ */
+static int configure(dmdrvi_context_t ctx)
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    size_t count = split_pins_by_port(&ctx->config, ports, pins);
+    for (size_t i = 0; i < count; i++)
+    {
+        dmgpio_config_t c = ctx->config;
+        c.port = ports[i];
+        c.pins = pins[i];
+        int ret = configure_port(&c);
+        if (ret != 0)
+            return ret;
+    }
+
+    mark_configured(ctx);
+    return 0;
+}
+
+/**
+ * @brief Configure the pins of a lazy device on its first access.
+ *
+ * Two threads racing on the first access may both run configure(); the
+ * register writes are idempotent, so that only costs the repeated writes.
+ */
+static int ensure_configured(dmdrvi_context_t ctx)
+{
+    if (__atomic_load_n(&ctx->configured, __ATOMIC_ACQUIRE))
+        return 0;
+
+    if (configure(ctx) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to configure GPIO P%s[0x%04X] on first access\n",
+            port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
+        return -EIO;
+    }
+    return 0;
+}
+
+/**
+ * @brief Start or stop queueing edge events for a device.
+ *
+ * Stopping only detaches the queue from the port: a deferred worker may
+ * still be running its handler, and a reader may still be waiting on it,
+ * so the memory is kept until _free and reused if events are enabled again.
+ *
+ * @return 0 on success, -EINVAL if the device has no interrupt trigger,
+ *         -ENOMEM / -EIO if the queue cannot be set up.
+ */
+static int set_event_queue_enabled(dmdrvi_context_t ctx, int enabled)
+{
+    dmgpio_event_queue_t *queue = ctx->event_queue;
+    if (enabled)
+    {
+        if (__atomic_load_n(&ctx->data_format, __ATOMIC_ACQUIRE) == dmgpio_data_format_events) return 0;
+        if (ctx->config.interrupt_trigger == dmgpio_int_trigger_off)
+        {
+            DMOD_LOG_ERROR("Event reads require 'interrupt_trigger' on P%s[0x%04X]\n",
+                port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
+            return -EINVAL;
+        }
+        if (queue == NULL)
+        {
+            queue = (dmgpio_event_queue_t *)Dmod_Malloc(sizeof(dmgpio_event_queue_t));
+            if (queue == NULL) return -ENOMEM;
+            memset(queue, 0, sizeof(dmgpio_event_queue_t));
+            ctx->event_queue = queue;
+        }
+        /* Events left from an earlier stream are stale */
+        __atomic_store_n(&queue->tail, queue->head, __ATOMIC_RELEASE);
+        if (dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
+                event_queue_handler, queue) != 0)
+            return -EIO;
+    }
+    else if (__atomic_load_n(&ctx->data_format, __ATOMIC_ACQUIRE) == dmgpio_data_format_events)
+    {
+        dmgpio_port_remove_interrupt_handler(ctx->config.port, queue);
+        /* The exchange cannot lose an overflow counted meanwhile by an ISR */
+        __atomic_fetch_add(&ctx->stats.interrupts_dropped,
+            __atomic_exchange_n(&queue->overflows, 0U, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+/**
+ * @brief Copy up to @p max_events queued events into @p out.
+ *
+ * Waits for the first event according to the device read timeout,
+ * polling once per millisecond, and gives up early if the device leaves
+ * the event format meanwhile.
+ */
+static size_t read_events(dmdrvi_context_t ctx, dmgpio_event_t *out, size_t max_events)
+{
+    dmgpio_event_queue_t *queue = ctx->event_queue;
+    uint32_t tail   = queue->tail;
+    uint32_t waited = 0U;
+    while (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == tail)
+    {
+        if (ctx->read_timeout_ms != DMGPIO_READ_TIMEOUT_INFINITE && waited >= ctx->read_timeout_ms)
+            return 0;
+        Dmod_SleepMs(1);
+        waited++;
+        if (__atomic_load_n(&ctx->data_format, __ATOMIC_ACQUIRE) != dmgpio_data_format_events)
+            return 0;
+    }
+
+    uint32_t head  = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    size_t   count = 0;
+    for (; tail != head && count < max_events; tail++, count++)
+        out[count] = queue->events[tail & (DMGPIO_EVENT_QUEUE_SIZE - 1U)];
+    __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+/**
+ * @brief Initialize the DMDRVI module
+ * 
+ * @param Config Pointer to Dmod_Config_t structure with configuration parameters
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+int dmod_init(const Dmod_Config_t *Config)
+{
+    Dmod_Printf("DMGPIO module initialized (STM32F7)\n");
+    return 0;
+}
+
+/**
+ * @brief Deinitialize the DMDRVI module
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+int dmod_deinit(void)
+{
+    Dmod_Printf("DMGPIO module deinitialized (STM32F7)\n");
+    return 0;
+}
+
+/* ---- Context lifecycle ---- */
+
+/**
+ * @brief Allocate a zeroed context.
+ */
+static dmdrvi_context_t alloc_context(void)
+{
+    dmdrvi_context_t ctx = (dmdrvi_context_t)Dmod_Malloc(sizeof(struct dmdrvi_context));
+    if (ctx == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate DMDRVI context\n");
+        return NULL;
+    }
+
+    memset(ctx, 0, sizeof(struct dmdrvi_context));
+    ctx->magic = DMGPIO_CONTEXT_MAGIC;
+    return ctx;
+}
+
+/**
+ * @brief Take ownership of the pins of a context whose configuration has
+ *        been read.
+ *
+ * The claim is a single compare-and-swap on each port's pin mask, so two
+ * devices created concurrently can never both get a pin.
+ *
+ * @return 0 on success, -EBUSY if any of the pins is already owned.
+ */
+static int claim_pins(dmdrvi_context_t ctx)
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    size_t count = split_pins_by_port(&ctx->config, ports, pins);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (dmgpio_port_claim_pins(ports[i], pins[i], ctx) == 0)
+            continue;
+
+        int used = 0;
+        dmgpio_port_check_is_pin_used(ports[i], pins[i], &used);
+        DMOD_LOG_ERROR("GPIO P%s[0x%04X] is %s\n", port_to_string(ports[i]), (unsigned)pins[i],
+            used ? "already used by another device" : "not a valid pin selection");
+        while (i-- > 0U)
+            dmgpio_port_release_pins(ports[i], pins[i], ctx);
+        return -EBUSY;
+    }
+    return 0;
+}
+
+/**
+ * @brief Give back the pins taken by claim_pins().
+ */
+static void release_pins(dmdrvi_context_t ctx)
+{
+    dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+    dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+    size_t count = split_pins_by_port(&ctx->config, ports, pins);
+    for (size_t i = 0; i < count; i++)
+        dmgpio_port_release_pins(ports[i], pins[i], ctx);
+}
+
+/**
+ * @brief Build the value mapping of a bus device (config.bus_width != 0).
+ *
+ * Bit b of a bus value is pin bus_pins[b]; every table entry is the OR of
+ * the pins (or value bits) selected by the set bits of its nibble.  The
+ * direction images hold the MODER fields of the bus pins only, so that a
+ * direction switch is one read-modify-write of MODER per port.
+ *
+ * @return 0 on success, -ENOMEM if the map cannot be allocated.
+ */
+static int new_bus_map(dmdrvi_context_t ctx)
+{
+    const dmgpio_config_t *c = &ctx->config;
+    dmgpio_bus_map_t *bus = (dmgpio_bus_map_t *)Dmod_Malloc(sizeof(dmgpio_bus_map_t));
+    if (bus == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate the bus map of GPIO P%s[0x%04X]\n",
+            port_to_string(c->port), (unsigned)c->pins);
+        return -ENOMEM;
+    }
+
+    memset(bus, 0, sizeof(dmgpio_bus_map_t));
+    bus->port_count    = split_pins_by_port(c, bus->ports, bus->pins);
+    bus->value_nibbles = (c->bus_width + 3U) / 4U;
+    for (uint32_t bit = 0; bit < c->bus_width; bit++)
+    {
+        uint32_t slot = 0;
+        while (bus->ports[slot] != (dmgpio_port_t)(c->bus_pins[bit] >> 4U))
+            slot++;
+        uint32_t word_bit = 16U * slot + (c->bus_pins[bit] & 0x0FU);
+        for (uint32_t v = 0; v < 16U; v++)
+        {
+            if ((v >> (bit % 4U)) & 1U)
+                bus->scatter[bit / 4U][v] |= 1ULL << word_bit;
+            if ((v >> (word_bit % 4U)) & 1U)
+                bus->gather[word_bit / 4U][v] |= 1UL << bit;
+        }
+    }
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+    {
+        uint32_t moder_mask = 0U;
+        for (uint32_t pin = 0; pin < 16U; pin++)
+            if ((bus->pins[slot] >> pin) & 1U)
+                moder_mask |= 3UL << (pin * 2U);
+        for (uint32_t output = 0; output < 2U; output++)
+        {
+            bus->direction[output][slot].port        = bus->ports[slot];
+            bus->direction[output][slot].moder.mask  = moder_mask;
+            bus->direction[output][slot].moder.value = output ? (0x55555555UL & moder_mask) : 0U;
+        }
+    }
+    ctx->bus = bus;
+    return 0;
+}
+
+/**
+ * @brief Register the interrupt handler of a context whose configuration
+ *        has been read.
+ */
+static int register_interrupt_handler(dmdrvi_context_t ctx)
+{
+    if (ctx->config.interrupt_stats &&
+        ctx->config.interrupt_trigger != dmgpio_int_trigger_off &&
+        dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
+            stats_interrupt_handler, ctx) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to add interrupt statistics handler\n");
+        return -EINVAL;
+    }
+
+    if (ctx->interrupt_handler_name != NULL)
+    {
+        if (dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
+                dmhaman_interrupt_handler, ctx) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to add named interrupt handler '%s'\n",
+                ctx->interrupt_handler_name);
+            dmgpio_port_remove_interrupt_handler(ctx->config.port, ctx);
+            return -EINVAL;
+        }
+    }
+    else if (ctx->config.interrupt_handler != NULL)
+    {
+        if (dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
+                (dmgpio_port_interrupt_handler_t)ctx->config.interrupt_handler, ctx) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to add initial interrupt handler\n");
+            dmgpio_port_remove_interrupt_handler(ctx->config.port, ctx);
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Copy the usage counters of @p ctx and fill in the derived fields.
+ */
+static void read_device_stats(dmdrvi_context_t ctx, dmgpio_device_stats_t *out)
+{
+    *out = ctx->stats;
+    if (ctx->event_queue != NULL)
+        out->interrupts_dropped += __atomic_load_n(&ctx->event_queue->overflows, __ATOMIC_RELAXED);
+
+    dmgpio_rate_limit_stats_t rate;
+    if (dmgpio_port_read_rate_limit_stats(ctx->config.port, ctx->config.pins, &rate) == 0)
+        out->interrupt_storms = rate.storms;
+    if (dmgpio_port_read_cycle_counter_rate(&out->counter_hz) != 0)
+        out->counter_hz = 0U;
+}
+
+/**
+ * @brief Allocate a context, read its configuration from @p section, claim
+ *        its pins and register its interrupt handler.  The pins are not
+ *        touched.
+ *
+ * @return The new context, or NULL on failure (nothing left allocated).
+ */
+static dmdrvi_context_t new_context(const config_section_t *section)
+{
+    dmdrvi_context_t ctx = alloc_context();
+    if (ctx == NULL)
+        return NULL;
+
+    if (read_config_parameters(ctx, section) != 0)
+    {
+        DMOD_LOG_ERROR("Failed to read GPIO configuration\n");
+        Dmod_Free(ctx->interrupt_handler_name);
+        Dmod_Free(ctx);
+        return NULL;
+    }
+
+    if (claim_pins(ctx) != 0)
+    {
+        Dmod_Free(ctx->interrupt_handler_name);
+        Dmod_Free(ctx);
+        return NULL;
+    }
+
+    if ((ctx->config.bus_width != 0U && new_bus_map(ctx) != 0) ||
+        register_interrupt_handler(ctx) != 0)
+    {
+        release_pins(ctx);
+        Dmod_Free(ctx->interrupt_handler_name);
+        Dmod_Free(ctx->bus);
+        Dmod_Free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/**
+ * @brief Allocate the context of the diagnostics device.
+ *
+ * The device owns no pins and has nothing to configure, so it is created
+ * as a lazy device that is already configured: the bring-up passes skip
+ * it and no access ever touches port A.  The dump buffer is allocated
+ * here so that reading it does not depend on the heap.
+ */
+static dmdrvi_context_t new_diagnostics_context(void)
+{
+    dmdrvi_context_t ctx = alloc_context();
+    if (ctx == NULL)
+        return NULL;
+
+    ctx->diag = (dmgpio_diag_dump_t *)Dmod_Malloc(sizeof(dmgpio_diag_dump_t));
+    if (ctx->diag == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate the diagnostics dump\n");
+        Dmod_Free(ctx);
+        return NULL;
+    }
+    ctx->diag->length  = 0U;
+    ctx->config.lazy   = 1;
+    ctx->configured    = 1U;
+    return ctx;
+}
+
+/**
+ * @brief Advance the length of a dump by the result of Dmod_SnPrintf,
+ *        stopping at the end of the buffer.
+ */
+static size_t dump_advance(size_t length, int written)
+{
+    if (written < 0)
+        return length;
+    length += (size_t)written;
+    return (length < DMGPIO_DIAG_TEXT_SIZE) ? length : DMGPIO_DIAG_TEXT_SIZE - 1U;
+}
+
+/**
+ * @brief Take a snapshot of the port layer and render it as text.
+ *
+ * One line per port with owned pins or handlers, one per handler in
+ * dispatch order and one per EXTI line that is enabled or has fired.
+ */
+static void render_diagnostics(dmgpio_diag_dump_t *dump)
+{
+    const dmgpio_diagnostics_t *d = &dump->snapshot;
+    char  *text   = dump->text;
+    size_t length = 0U;
+
+    if (dmgpio_port_read_diagnostics(&dump->snapshot) != 0)
+    {
+        dump->length = 0U;
+        return;
+    }
+
+    length = dump_advance(length, Dmod_SnPrintf(text + length, DMGPIO_DIAG_TEXT_SIZE - length,
+        "handlers=%u\n", (unsigned)d->handler_count));
+    uint32_t listed = (d->handler_count < DMGPIO_DIAG_HANDLERS) ? d->handler_count : DMGPIO_DIAG_HANDLERS;
+    for (uint32_t port = 0; port < DMGPIO_DIAG_PORTS; port++)
+    {
+        int has_handlers = 0;
+        for (uint32_t i = 0; i < listed; i++)
+            has_handlers |= (d->handlers[i].port == port);
+        if (d->pins_used[port] == 0U && !has_handlers)
+            continue;
+
+        length = dump_advance(length, Dmod_SnPrintf(text + length, DMGPIO_DIAG_TEXT_SIZE - length,
+            "P%s used=0x%04X\n", port_to_string((dmgpio_port_t)port), (unsigned)d->pins_used[port]));
+        for (uint32_t i = 0; i < listed; i++)
+        {
+            const dmgpio_diag_handler_t *h = &d->handlers[i];
+            if (h->port != port)
+                continue;
+            length = dump_advance(length, Dmod_SnPrintf(text + length, DMGPIO_DIAG_TEXT_SIZE - length,
+                "P%s handler pins=0x%04X owner=%p fn=%p\n", port_to_string(h->port), (unsigned)h->pins,
+                h->owner, (void *)(uintptr_t)h->handler));
+        }
+    }
+
+    for (uint32_t line = 0; line < 16U; line++)
+    {
+        uint32_t bit     = 1UL << line;
+        uint32_t enabled = (d->exti_imr | d->exti_rtsr | d->exti_ftsr) & bit;
+        if (enabled == 0U && d->line_interrupts[line] == 0U)
+            continue;
+
+        dmgpio_port_t port = (dmgpio_port_t)((d->exticr[line / 4U] >> ((line % 4U) * 4U)) & 0xFU);
+        length = dump_advance(length, Dmod_SnPrintf(text + length, DMGPIO_DIAG_TEXT_SIZE - length,
+            "EXTI%u port=P%s imr=%u rtsr=%u ftsr=%u interrupts=%lu\n", (unsigned)line, port_to_string(port),
+            (unsigned)((d->exti_imr & bit) != 0U), (unsigned)((d->exti_rtsr & bit) != 0U),
+            (unsigned)((d->exti_ftsr & bit) != 0U), (unsigned long)d->line_interrupts[line]));
+    }
+    dump->length = length;
+}
+
+/**
+ * @brief Read of the diagnostics device: a slice of the dump text.
+ */
+static size_t read_diagnostics(dmgpio_diag_dump_t *dump, void *buffer, size_t size, uint32_t offset)
+{
+    if (offset == 0U)
+        render_diagnostics(dump);
+    if (offset >= dump->length)
+        return 0;
+
+    size_t available = dump->length - offset;
+    size_t to_copy   = (available < size) ? available : size;
+    memcpy(buffer, dump->text + offset, to_copy);
+    return to_copy;
+}
+
+/**
+ * @brief Read the state of the device's pins as the value it reports: the
+ *        port mask of the high pins, or the packed value on a bus device.
+ *
+ * The input registers of a bus spanning several ports are sampled together
+ * with interrupts masked.
+ */
+static uint32_t read_value(dmdrvi_context_t ctx)
+{
+    const dmgpio_bus_map_t *bus = ctx->bus;
+    if (bus == NULL)
+        return dmgpio_port_get_high_state_pins(ctx->config.port, ctx->config.pins);
+
+    dmgpio_pins_mask_t data[DMGPIO_BUS_MAX_PORTS];
+    if (bus->port_count == 1U)
+        data[0] = dmgpio_port_get_high_state_pins(bus->ports[0], bus->pins[0]);
+    else if (dmgpio_port_read_multi(bus->ports, data, bus->port_count) != 0)
+        return 0U;
+
+    uint32_t value = 0U;
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+    {
+        uint32_t high = data[slot] & bus->pins[slot];
+        const uint32_t (*gather)[16] = &bus->gather[4U * slot];
+        value |= gather[0][high & 0x0FU] | gather[1][(high >> 4U) & 0x0FU] |
+                 gather[2][(high >> 8U) & 0x0FU] | gather[3][(high >> 12U) & 0x0FU];
+    }
+    return value;
+}
+
+/**
+ * @brief Drive the device's pins from a value in the format of read_value.
+ *
+ * A bus is one BSRR store per port whatever the pin order; the stores of a
+ * bus spanning several ports are precomputed and issued back-to-back with
+ * interrupts masked, so the ports switch a few bus cycles apart.
+ */
+static void write_value(dmdrvi_context_t ctx, uint32_t value)
+{
+    const dmgpio_bus_map_t *bus = ctx->bus;
+    if (bus == NULL)
+    {
+        dmgpio_port_write_data(ctx->config.port, ctx->config.pins, (dmgpio_pins_mask_t)value);
+        return;
+    }
+
+    uint64_t high = 0U;
+    for (uint32_t nibble = 0; nibble < bus->value_nibbles; nibble++)
+        high |= bus->scatter[nibble][(value >> (4U * nibble)) & 0x0FU];
+    if (bus->port_count == 1U)
+    {
+        dmgpio_port_write_data(bus->ports[0], bus->pins[0], (dmgpio_pins_mask_t)high);
+        return;
+    }
+
+    uint32_t set_reset[DMGPIO_BUS_MAX_PORTS];
+    for (size_t slot = 0; slot < bus->port_count; slot++)
+    {
+        uint32_t set = (uint32_t)(high >> (16U * slot)) & bus->pins[slot];
+        set_reset[slot] = set | ((bus->pins[slot] & ~set) << 16U);
+    }
+    dmgpio_port_write_multi(bus->ports, set_reset, bus->port_count);
+}
+
+/**
+ * @brief Whether an ioctl command works on the port mask of config.pins.
+ */
+static int is_pin_mask_command(int command)
+{
+    switch ((dmgpio_ioctl_cmd_t)command)
+    {
+        case dmgpio_ioctl_cmd_toggle_pins:
+        case dmgpio_ioctl_cmd_set_pins_state:
+        case dmgpio_ioctl_cmd_get_high_pins_state:
+        case dmgpio_ioctl_cmd_get_low_pins_state:
+        case dmgpio_ioctl_cmd_set_interrupt_handler:
+        case dmgpio_ioctl_cmd_get_direct_access:
+        case dmgpio_ioctl_cmd_get_rate_limit_stats:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Run the operations of a dmgpio_ioctl_cmd_run_batch in order.
+ *
+ * The batch is checked as a whole first, so an invalid operation fails it
+ * before any pin changes.  The mask operations address one port, so they
+ * are not accepted on a bus spanning several ports.
+ *
+ * @return 0 on success, -EINVAL on an invalid batch.
+ */
+static int run_batch(dmdrvi_context_t ctx, const dmgpio_batch_t *batch)
+{
+    if (batch->ops == NULL && batch->count != 0U)
+        return -EINVAL;
+    int several_ports = (ctx->bus != NULL && ctx->bus->port_count > 1U);
+    for (uint32_t i = 0; i < batch->count; i++)
+    {
+        switch (batch->ops[i].op)
+        {
+            case dmgpio_batch_op_set:
+            case dmgpio_batch_op_reset:
+            case dmgpio_batch_op_toggle:
+                if (!several_ports)
+                    continue;
+                break;
+            case dmgpio_batch_op_write:
+            case dmgpio_batch_op_read:
+                continue;
+            default:
+                break;
+        }
+        DMOD_LOG_ERROR("Invalid batch operation %d at index %u\n", (int)batch->ops[i].op, (unsigned)i);
+        return -EINVAL;
+    }
+
+    dmgpio_port_t      port    = ctx->config.port;
+    dmgpio_pins_mask_t pins    = ctx->config.pins;
+    uint32_t           toggles = 0;
+    for (uint32_t i = 0; i < batch->count; i++)
     {
-        DMOD_LOG_ERROR("Failed to finish configuration for GPIO port %s pins 0x%04X\n",
-            port_to_string(c->port), (unsigned)c->pins);
-        return ret;
+        dmgpio_batch_op_t *o = &batch->ops[i];
+        switch (o->op)
+        {
+            case dmgpio_batch_op_set:
+                dmgpio_port_write_data(port, pins & (dmgpio_pins_mask_t)o->value, 0xFFFFU);
+                break;
+            case dmgpio_batch_op_reset:
+                dmgpio_port_write_data(port, pins & (dmgpio_pins_mask_t)o->value, 0U);
+                break;
+            case dmgpio_batch_op_toggle:
+                dmgpio_port_toggle_pins_state(port, pins & (dmgpio_pins_mask_t)o->value);
+                toggles++;
+                break;
+            case dmgpio_batch_op_write:
+                write_value(ctx, o->value);
+                break;
+            default:
+                o->value = read_value(ctx);
+                break;
+        }
     }
-
-    dmgpio_port_set_pins_used(c->port, c->pins);
-
-    DMOD_LOG_INFO("GPIO P%s[0x%04X] configured: mode=%s, pull=%s, speed=%s, circuit=%s\n",
-        port_to_string(c->port), (unsigned)c->pins,
-        mode_to_string(c->mode),
-        pull_to_string(c->pull),
-        speed_to_string(c->speed),
-        output_circuit_to_string(c->output_circuit));
+    if (toggles != 0U)
+        __atomic_fetch_add(&ctx->stats.toggles, toggles, __ATOMIC_RELAXED);
     return 0;
 }
 
 /**
- * @brief Initialize the DMDRVI module
- * 
- * @param Config Pointer to Dmod_Config_t structure with configuration parameters
- * 
- * @return int 0 on success, non-zero on failure
+ * @brief Whether the values of the device need more than 16 bits.
  */
-int dmod_init(const Dmod_Config_t *Config)
+static int is_wide(dmdrvi_context_t ctx)
 {
-    Dmod_Printf("DMGPIO module initialized (STM32F7)\n");
-    return 0;
+    return ctx->config.bus_width > 16U;
 }
 
 /**
- * @brief Deinitialize the DMDRVI module
- * 
- * @return int 0 on success, non-zero on failure
+ * @brief Release a context from new_context() whose configuration failed.
  */
-int dmod_deinit(void)
+static void delete_context(dmdrvi_context_t ctx)
 {
-    Dmod_Printf("DMGPIO module deinitialized (STM32F7)\n");
-    return 0;
+    dmgpio_port_remove_interrupt_handler(ctx->config.port, ctx);
+    release_pins(ctx);
+    ctx->magic = 0;
+    Dmod_Free(ctx->interrupt_handler_name);
+    Dmod_Free(ctx->diag);
+    Dmod_Free(ctx->bus);
+    Dmod_Free(ctx);
+}
+
+/**
+ * @brief Fill the device number of a created device.
+ *
+ * @param section Section the configuration was read from.
+ */
+static void fill_dev_num(dmdrvi_context_t ctx, const char *section, dmdrvi_dev_num_t *dev_num)
+{
+    /* Encode the GPIO port as the major number and the lowest configured
+     * pin index as the minor number.  This gives dmdevfs a stable, unique
+     * path of the form "dmgpio<port>/<pin>" (e.g. "dmgpio8/1" for PI1). */
+    int pin = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (ctx->config.pins & (dmgpio_pins_mask_t)(1U << i))
+        {
+            pin = i;
+            break;
+        }
+    }
+    /* The diagnostics device has no pin, so only a named section gives it a path */
+    dev_num->flags = (ctx->diag != NULL) ? 0 : (DMDRVI_NUM_MAJOR | DMDRVI_NUM_MINOR);
+    dev_num->major = (dmdrvi_dev_id_t)ctx->config.port;
+    dev_num->minor = (dmdrvi_dev_id_t)pin;
+
+    /* If the config uses a named section (e.g. [led_ld1] or [button_b1])
+     * populate alt_name so the device filesystem registers the device
+     * under that human-friendly name instead of the numeric path. */
+    if (strcmp(section, "dmgpio") != 0)
+    {
+        size_t name_len = strlen(section);
+        if (name_len <= DMDRVI_ALT_NAME_MAX_LEN)
+        {
+            dev_num->flags |= DMDRVI_NUM_ALT_NAME;
+            memcpy(dev_num->alt_name, section, name_len + 1);
+        }
+    }
 }
 
 /* ---- DMDRVI interface ---- */
 dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, dmdrvi_context_t, _create,
     ( dmini_context_t config, dmdrvi_dev_num_t* dev_num ))
 {
-    dmdrvi_context_t ctx = (dmdrvi_context_t)Dmod_Malloc(sizeof(struct dmdrvi_context));
-    if (ctx == NULL)
+    char section_buf[DMGPIO_SECTION_BUF_SIZE];
+    config_section_t section = { .ini = config };
+    section.name = detect_config_section(config, section_buf, sizeof(section_buf));
+
+    if (is_diagnostics_section(&section))
     {
-        DMOD_LOG_ERROR("Failed to allocate DMDRVI context\n");
-        return NULL;
+        dmdrvi_context_t diag = new_diagnostics_context();
+        if (diag != NULL && dev_num != NULL)
+            fill_dev_num(diag, section.name, dev_num);
+        return diag;
     }
 
-    memset(ctx, 0, sizeof(struct dmdrvi_context));
-    ctx->magic = DMGPIO_CONTEXT_MAGIC;
-
-    if (read_config_parameters(ctx, config) != 0)
-    {
-        DMOD_LOG_ERROR("Failed to read GPIO configuration\n");
-        Dmod_Free(ctx);
+    dmdrvi_context_t ctx = new_context(&section);
+    if (ctx == NULL)
         return NULL;
-    }
 
-    if (ctx->interrupt_handler_name != NULL)
+    if (ctx->config.lazy)
     {
-        if (dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
-                dmhaman_interrupt_handler, ctx) != 0)
-        {
-            DMOD_LOG_ERROR("Failed to add named interrupt handler '%s'\n",
-                ctx->interrupt_handler_name);
-            Dmod_Free(ctx->interrupt_handler_name);
-            Dmod_Free(ctx);
-            return NULL;
-        }
-    }
-    else if (ctx->config.interrupt_handler != NULL)
-    {
-        if (dmgpio_port_add_interrupt_handler(ctx->config.port, ctx->config.pins,
-                (dmgpio_port_interrupt_handler_t)ctx->config.interrupt_handler, ctx) != 0)
-        {
-            DMOD_LOG_ERROR("Failed to add initial interrupt handler\n");
-            Dmod_Free(ctx);
-            return NULL;
-        }
+        DMOD_LOG_INFO("GPIO P%s[0x%04X] will be configured on first access\n",
+            port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
     }
-
-    if (configure(ctx) != 0)
+    else if (configure(ctx) != 0)
     {
         DMOD_LOG_ERROR("Failed to configure GPIO\n");
-        dmgpio_port_remove_interrupt_handler(ctx->config.port, ctx);
-        Dmod_Free(ctx->interrupt_handler_name);
-        Dmod_Free(ctx);
+        delete_context(ctx);
         return NULL;
     }
 
@@ -639,41 +1931,7 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, dmdrvi_context_t, _create,
         port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
 
     if (dev_num != NULL)
-    {
-        /* Encode the GPIO port as the major number and the lowest configured
-         * pin index as the minor number.  This gives dmdevfs a stable, unique
-         * path of the form "dmgpio<port>/<pin>" (e.g. "dmgpio8/1" for PI1). */
-        int pin = 0;
-        for (int i = 0; i < 16; i++)
-        {
-            if (ctx->config.pins & (dmgpio_pins_mask_t)(1U << i))
-            {
-                pin = i;
-                break;
-            }
-        }
-        dev_num->flags = DMDRVI_NUM_MAJOR | DMDRVI_NUM_MINOR;
-        dev_num->major = (dmdrvi_dev_id_t)ctx->config.port;
-        dev_num->minor = (dmdrvi_dev_id_t)pin;
-
-        /* If the config uses a named section (e.g. [led_ld1] or [button_b1])
-         * populate alt_name so the device filesystem registers the device
-         * under that human-friendly name instead of the numeric path.
-         *
-         * detect_config_section always returns a non-NULL pointer ("dmgpio"
-         * as a fallback or the section_buf pointer on success). */
-        char section_buf[DMDRVI_ALT_NAME_MAX_LEN + 1];
-        const char *section = detect_config_section(config, section_buf, sizeof(section_buf));
-        if (strcmp(section, "dmgpio") != 0)
-        {
-            size_t name_len = strlen(section);
-            if (name_len <= DMDRVI_ALT_NAME_MAX_LEN)
-            {
-                dev_num->flags |= DMDRVI_NUM_ALT_NAME;
-                memcpy(dev_num->alt_name, section, name_len + 1);
-            }
-        }
-    }
+        fill_dev_num(ctx, section.name, dev_num);
 
     return ctx;
 }
@@ -682,10 +1940,14 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, void, _free, ( dmdrvi_context_t con
 {
     if (is_valid_context(context))
     {
+        set_event_queue_enabled(context, 0);
         dmgpio_port_remove_interrupt_handler(context->config.port, context);
-        dmgpio_port_set_pins_unused(context->config.port, context->config.pins);
+        release_pins(context);
         context->magic = 0;
+        Dmod_Free(context->event_queue);
         Dmod_Free(context->interrupt_handler_name);
+        Dmod_Free(context->diag);
+        Dmod_Free(context->bus);
         Dmod_Free(context);
     }
 }
@@ -698,6 +1960,8 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, void*, _open,
         DMOD_LOG_ERROR("Invalid DMDRVI context in dmgpio_dmdrvi_open\n");
         return NULL;
     }
+    if (ensure_configured(context) != 0)
+        return NULL;
     return context;
 }
 
@@ -715,23 +1979,57 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, void, _close,
  * @p offset is a byte offset into that content, enabling standard
  * pread()-style access.  A @p offset at or beyond the content length
  * returns 0 bytes (EOF), which is how tools like `cat` detect end-of-file.
+ *
+ * In dmgpio_data_format_raw the content is the 2-byte little-endian mask
+ * instead, and no formatting is done.  On a bus device both formats hold
+ * the packed bus value instead of the mask.
+ *
+ * In dmgpio_data_format_events the device is a stream instead: each read
+ * returns as many whole dmgpio_event_t records as fit in @p size and are
+ * queued, @p offset is ignored, and an empty queue waits up to the read
+ * timeout (0 by default, i.e. returns 0 immediately).
  */
 dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, size_t, _read,
     ( dmdrvi_context_t context, void* handle, void* buffer, size_t size, uint32_t offset ))
 {
     if (!is_valid_context(context) || buffer == NULL)
         return 0;
+    __atomic_fetch_add(&context->stats.reads, 1U, __ATOMIC_RELAXED);
 
     /* size == 0 is a no-op; return 0 without error */
-    if (size == 0)
+    if (size == 0 || ensure_configured(context) != 0)
         return 0;
 
+    if (context->diag != NULL)
+        return read_diagnostics(context->diag, buffer, size, offset);
+
+    if (__atomic_load_n(&context->data_format, __ATOMIC_ACQUIRE) == dmgpio_data_format_events)
+    {
+        size_t max_events = size / sizeof(dmgpio_event_t);
+        if (max_events == 0)
+            return 0;
+        return read_events(context, (dmgpio_event_t *)buffer, max_events) * sizeof(dmgpio_event_t);
+    }
+
+    if (__atomic_load_n(&context->data_format, __ATOMIC_ACQUIRE) == dmgpio_data_format_raw)
+    {
+        size_t raw_size = is_wide(context) ? DMGPIO_WIDE_RAW_DATA_SIZE : DMGPIO_RAW_DATA_SIZE;
+        if (offset >= raw_size)
+            return 0;
+
+        uint32_t value = read_value(context);
+        uint8_t raw[DMGPIO_WIDE_RAW_DATA_SIZE] = {
+            (uint8_t)value, (uint8_t)(value >> 8U), (uint8_t)(value >> 16U), (uint8_t)(value >> 24U) };
+        size_t available = raw_size - offset;
+        size_t to_copy   = (available < size) ? available : size;
+        memcpy(buffer, raw + offset, to_copy);
+        return to_copy;
+    }
+
     /* Build the current content string */
-    char content[DMGPIO_STATE_BUF_SIZE]; /* "0x%04X\0" */
-    dmgpio_pins_mask_t high_pins = dmgpio_port_get_high_state_pins(
-        context->config.port, context->config.pins);
-    int content_len = Dmod_SnPrintf(content, sizeof(content), "0x%04X",
-        (unsigned)high_pins);
+    char content[DMGPIO_WIDE_STATE_STR_LEN + 1]; /* "0x%04X\0" or "0x%08X\0" */
+    int content_len = Dmod_SnPrintf(content, sizeof(content), is_wide(context) ? "0x%08lX" : "0x%04lX",
+        (unsigned long)read_value(context));
     if (content_len <= 0)
         return 0;
 
@@ -751,6 +2049,9 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, size_t, _read,
  *        and applies it to the configured pins.  Trailing whitespace and newlines
  *        (e.g. appended by the shell's `echo`) are silently stripped.
  *
+ * In dmgpio_data_format_raw the buffer must hold exactly the 2-byte
+ * little-endian mask, which is passed straight to dmgpio_port_write_data().
+ *
  * @p offset is not meaningful for GPIO (the state is a single atomic value) and
  * is ignored.
  */
@@ -759,8 +2060,33 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, size_t, _write,
 {
     (void)offset; /* GPIO state is a single atomic value; byte offset is not applicable */
 
-    if (!is_valid_context(context) || buffer == NULL || size == 0)
+    if (!is_valid_context(context) || buffer == NULL || size == 0 ||
+        ensure_configured(context) != 0)
+        return 0;
+    __atomic_fetch_add(&context->stats.writes, 1U, __ATOMIC_RELAXED);
+
+    if (context->diag != NULL)
+    {
+        DMOD_LOG_ERROR("The diagnostics device is read-only\n");
         return 0;
+    }
+
+    if (__atomic_load_n(&context->data_format, __ATOMIC_ACQUIRE) == dmgpio_data_format_raw)
+    {
+        size_t raw_size = is_wide(context) ? DMGPIO_WIDE_RAW_DATA_SIZE : DMGPIO_RAW_DATA_SIZE;
+        if (size != raw_size)
+        {
+            DMOD_LOG_ERROR("Invalid raw write size %u for _write (expected %u)\n",
+                (unsigned)size, (unsigned)raw_size);
+            return 0;
+        }
+        const uint8_t *raw = (const uint8_t *)buffer;
+        uint32_t value = 0U;
+        for (size_t i = 0; i < raw_size; i++)
+            value |= (uint32_t)raw[i] << (8U * i);
+        write_value(context, value);
+        return size;
+    }
 
     /* Copy to a local buffer and null-terminate */
     char tmp[DMGPIO_WRITE_BUF_SIZE];
@@ -788,15 +2114,15 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, size_t, _write,
         return 0;
     }
 
+    /* Wide buses read back as "0x%08lX", so writes take the same range */
     unsigned long val;
-    if (parse_uint(start, &val) != 0)
+    if (parse_uint_max(start, is_wide(context) ? 0xFFFFFFFFUL : 0xFFFFUL, &val) != 0)
     {
         DMOD_LOG_ERROR("Invalid pin state value for _write: '%s'\n", tmp);
         return 0;
     }
 
-    dmgpio_port_write_data(context->config.port, context->config.pins,
-        (dmgpio_pins_mask_t)val);
+    write_value(context, (uint32_t)val);
     return size;
 }
 
@@ -808,10 +2134,29 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, int, _ioctl,
         DMOD_LOG_ERROR("Invalid DMDRVI context in dmgpio_dmdrvi_ioctl\n");
         return -EINVAL;
     }
+    if (ensure_configured(context) != 0)
+        return -EIO;
+    __atomic_fetch_add(&context->stats.ioctls, 1U, __ATOMIC_RELAXED);
+
+    if (context->diag != NULL &&
+        command != dmgpio_ioctl_cmd_get_diagnostics && command != dmgpio_ioctl_cmd_get_stats)
+    {
+        DMOD_LOG_ERROR("Ioctl command %d is not supported by the diagnostics device\n", command);
+        return -EINVAL;
+    }
+
+    /* The pin mask commands address one port; a bus spanning several
+     * ports is driven through _read/_write only */
+    if (context->bus != NULL && context->bus->port_count > 1U && is_pin_mask_command(command))
+    {
+        DMOD_LOG_ERROR("Ioctl command %d is not supported by a bus spanning several ports\n", command);
+        return -EINVAL;
+    }
 
     switch ((dmgpio_ioctl_cmd_t)command)
     {
         case dmgpio_ioctl_cmd_toggle_pins:
+            __atomic_fetch_add(&context->stats.toggles, 1U, __ATOMIC_RELAXED);
             dmgpio_port_toggle_pins_state(context->config.port, context->config.pins);
             return 0;
 
@@ -840,6 +2185,86 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, int, _ioctl,
                 (dmgpio_port_interrupt_handler_t)*(dmgpio_interrupt_handler_t *)arg,
                 context);
 
+        case dmgpio_ioctl_cmd_set_data_format:
+            if (arg == NULL) return -EINVAL;
+            switch (*(dmgpio_data_format_t *)arg)
+            {
+                case dmgpio_data_format_text:
+                case dmgpio_data_format_raw:
+                    set_event_queue_enabled(context, 0);
+                    __atomic_store_n(&context->data_format, *(dmgpio_data_format_t *)arg, __ATOMIC_RELEASE);
+                    return 0;
+                case dmgpio_data_format_events:
+                {
+                    int ret = set_event_queue_enabled(context, 1);
+                    if (ret == 0)
+                        __atomic_store_n(&context->data_format, dmgpio_data_format_events, __ATOMIC_RELEASE);
+                    return ret;
+                }
+                default:
+                    return -EINVAL;
+            }
+
+        case dmgpio_ioctl_cmd_get_data_format:
+            if (arg == NULL) return -EINVAL;
+            *(dmgpio_data_format_t *)arg = __atomic_load_n(&context->data_format, __ATOMIC_ACQUIRE);
+            return 0;
+
+        case dmgpio_ioctl_cmd_get_direct_access:
+            if (arg == NULL) return -EINVAL;
+            return dmgpio_port_get_direct_access(context->config.port, context->config.pins,
+                (dmgpio_direct_access_t *)arg) == 0 ? 0 : -EIO;
+
+        case dmgpio_ioctl_cmd_process_interrupts:
+        {
+            if (arg == NULL) return -EINVAL;
+            int processed = dmgpio_port_process_deferred_interrupts(*(uint32_t *)arg);
+            if (processed < 0) return -EIO;
+            *(uint32_t *)arg = (uint32_t)processed;
+            return 0;
+        }
+
+        case dmgpio_ioctl_cmd_set_read_timeout:
+            if (arg == NULL) return -EINVAL;
+            context->read_timeout_ms = *(uint32_t *)arg;
+            return 0;
+
+        case dmgpio_ioctl_cmd_get_event_overflows:
+            if (arg == NULL) return -EINVAL;
+            *(uint32_t *)arg = (context->event_queue != NULL) ?
+                __atomic_load_n(&context->event_queue->overflows, __ATOMIC_RELAXED) : 0U;
+            return 0;
+
+        case dmgpio_ioctl_cmd_get_rate_limit_stats:
+            if (arg == NULL) return -EINVAL;
+            return dmgpio_port_read_rate_limit_stats(context->config.port, context->config.pins,
+                (dmgpio_rate_limit_stats_t *)arg) == 0 ? 0 : -EIO;
+
+        case dmgpio_ioctl_cmd_get_stats:
+            if (arg == NULL) return -EINVAL;
+            read_device_stats(context, (dmgpio_device_stats_t *)arg);
+            return 0;
+
+        case dmgpio_ioctl_cmd_get_diagnostics:
+            if (arg == NULL) return -EINVAL;
+            return dmgpio_port_read_diagnostics((dmgpio_diagnostics_t *)arg) == 0 ? 0 : -EIO;
+
+        case dmgpio_ioctl_cmd_run_batch:
+            if (arg == NULL) return -EINVAL;
+            return run_batch(context, (const dmgpio_batch_t *)arg);
+
+        case dmgpio_ioctl_cmd_set_bus_direction:
+        {
+            if (arg == NULL || context->bus == NULL) return -EINVAL;
+            dmgpio_mode_t mode = *(dmgpio_mode_t *)arg;
+            if (mode != dmgpio_mode_input && mode != dmgpio_mode_output) return -EINVAL;
+            for (size_t slot = 0; slot < context->bus->port_count; slot++)
+                if (dmgpio_port_apply_image(&context->bus->direction[mode == dmgpio_mode_output][slot]) != 0)
+                    return -EIO;
+            context->config.mode = mode;
+            return 0;
+        }
+
         default:
             DMOD_LOG_ERROR("Unknown ioctl command %d\n", command);
             return -EINVAL;
@@ -860,7 +2285,286 @@ dmod_dmdrvi_dif_api_declaration(1.0, dmgpio, int, _stat,
         DMOD_LOG_ERROR("Invalid parameters in dmgpio_dmdrvi_stat\n");
         return -EINVAL;
     }
-    stat->size = DMGPIO_STATE_STR_LEN;  /* content is always "0x%04X": 6 bytes */
-    stat->mode = 0666;
+    /* content is "0x%04X" (6 bytes), the raw little-endian mask (2 bytes)
+     * or, for the event stream, the records currently queued; the
+     * diagnostics device reports its last dump, taking one if needed */
+    if (context->diag != NULL)
+    {
+        if (context->diag->length == 0U)
+            render_diagnostics(context->diag);
+        stat->size = (uint32_t)context->diag->length;
+        stat->mode = 0444;
+    }
+    else
+    {
+        switch (__atomic_load_n(&context->data_format, __ATOMIC_ACQUIRE))
+        {
+            case dmgpio_data_format_raw:
+                stat->size = is_wide(context) ? DMGPIO_WIDE_RAW_DATA_SIZE : DMGPIO_RAW_DATA_SIZE;
+                break;
+            case dmgpio_data_format_events:
+                stat->size = (__atomic_load_n(&context->event_queue->head, __ATOMIC_ACQUIRE) -
+                    context->event_queue->tail) * sizeof(dmgpio_event_t);
+                break;
+            default:
+                stat->size = is_wide(context) ? DMGPIO_WIDE_STATE_STR_LEN : DMGPIO_STATE_STR_LEN;
+                break;
+        }
+        stat->mode = 0666;
+    }
+    /* the caller passed a dmgpio_stat_t, which starts with the dmdrvi_stat_t */
+    if (path != NULL && strcmp(path, DMGPIO_STAT_PATH_STATS) == 0)
+        read_device_stats(context, &((dmgpio_stat_t *)stat)->counters);
+    return 0;
+}
+/* ---- Batch creation ---- */
+
+dmod_dmgpio_api_declaration(1.0, int, _create_all,
+    ( dmini_context_t config, dmdrvi_context_t *out_contexts, dmdrvi_dev_num_t *out_dev_nums, size_t max_devices ))
+{
+    if (config == NULL || out_contexts == NULL)
+        return -EINVAL;
+
+    char  stack_buf[DMGPIO_INI_STACK_BUF_SIZE];
+    char *ini_str = generate_ini_string(config, stack_buf, sizeof(stack_buf));
+    if (ini_str == NULL)
+        return 0;
+
+    /* Pass 1: split the text into sections, read every GPIO section and
+     * register the handlers; no pin is touched yet. */
+    size_t           count  = 0;
+    uint32_t         ports  = 0;
+    char            *cursor = ini_str;
+    config_section_t section;
+    while (count < max_devices && split_next_section(&cursor, config, &section) == 0)
+    {
+        if (!is_gpio_section(&section))
+            continue;
+
+        dmdrvi_context_t ctx = is_diagnostics_section(&section)
+            ? new_diagnostics_context() : new_context(&section);
+        if (ctx == NULL)
+        {
+            DMOD_LOG_ERROR("Skipping GPIO section [%s]\n", section.name);
+            continue;
+        }
+        if (out_dev_nums != NULL)
+            fill_dev_num(ctx, section.name, &out_dev_nums[count]);
+        out_contexts[count++] = ctx;
+        if (!ctx->config.lazy)
+            ports |= spanned_ports(&ctx->config);
+    }
+    release_ini_string(ini_str, stack_buf);
+
+    /* Pass 2: power each port once and open one configuration session per
+     * port, so its registers are committed once for all of its devices. */
+    uint32_t ready_ports = 0;
+    for (uint32_t p = ports; p != 0U; p &= p - 1U)
+    {
+        dmgpio_port_t port = (dmgpio_port_t)__builtin_ctz(p);
+        if (dmgpio_port_set_power(port, 1) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to enable power for GPIO port %s\n", port_to_string(port));
+            continue;
+        }
+        if (dmgpio_port_begin_configuration(port, 0xFFFFU) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to begin configuration for GPIO port %s\n", port_to_string(port));
+            continue;
+        }
+        ready_ports |= 1UL << port;
+    }
+
+    /* Pass 3: stage every device's settings, then commit each port.  A
+     * device whose settings fail is marked by clearing its magic, and what
+     * it staged so far is undone, so the commit leaves its pins as they
+     * were.  Lazy devices are left for their first access. */
+    uint32_t failed_ports = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        dmgpio_config_t    c = out_contexts[i]->config;
+        dmgpio_port_t      ports[DMGPIO_BUS_MAX_PORTS];
+        dmgpio_pins_mask_t pins[DMGPIO_BUS_MAX_PORTS];
+        uint8_t            triggers[DMGPIO_BUS_MAX_WIDTH];
+        uint32_t           device_ports = spanned_ports(&c);
+        if (c.lazy)
+            continue;
+        if ((ready_ports & device_ports) != device_ports || save_interrupt_triggers(&c, triggers) != 0)
+        {
+            out_contexts[i]->magic = 0;
+            continue;
+        }
+        for (size_t p = split_pins_by_port(&out_contexts[i]->config, ports, pins); p > 0U; p--)
+        {
+            c.port = ports[p - 1U];
+            c.pins = pins[p - 1U];
+            if (apply_pin_settings(&c) != 0)
+            {
+                undo_pin_settings(&out_contexts[i]->config, triggers);
+                out_contexts[i]->magic = 0;
+                break;
+            }
+        }
+    }
+    for (uint32_t p = ready_ports; p != 0U; p &= p - 1U)
+    {
+        dmgpio_port_t port = (dmgpio_port_t)__builtin_ctz(p);
+        if (dmgpio_port_finish_configuration(port, 0xFFFFU) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to finish configuration for GPIO port %s\n", port_to_string(port));
+            failed_ports |= 1UL << port;
+        }
+    }
+
+    /* Drop the failed devices and compact the output arrays. */
+    size_t created = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        dmdrvi_context_t ctx = out_contexts[i];
+        if (!is_valid_context(ctx) ||
+            (!ctx->config.lazy && (failed_ports & spanned_ports(&ctx->config)) != 0U))
+        {
+            DMOD_LOG_ERROR("Failed to configure GPIO P%s[0x%04X]\n",
+                port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
+            delete_context(ctx);
+            continue;
+        }
+        if (!ctx->config.lazy)
+            mark_configured(ctx);
+        out_contexts[created] = ctx;
+        if (out_dev_nums != NULL)
+            out_dev_nums[created] = out_dev_nums[i];
+        created++;
+    }
+    return (int)created;
+}
+
+dmod_dmgpio_api_declaration(1.0, int, _create_from_board,
+    ( const dmgpio_board_t *board, dmdrvi_context_t *out_contexts, dmdrvi_dev_num_t *out_dev_nums, size_t max_devices ))
+{
+    if (board == NULL || out_contexts == NULL || max_devices < board->device_count)
+        return -EINVAL;
+
+    /* Pass 1: create the contexts and register the handlers before any
+     * interrupt is enabled by the images. */
+    size_t count = 0;
+    for (size_t i = 0; i < board->device_count; i++)
+    {
+        const dmgpio_board_device_t *device = &board->devices[i];
+        dmdrvi_context_t ctx = device->diagnostics ? new_diagnostics_context() : alloc_context();
+        if (ctx == NULL)
+            continue;
+        if (device->diagnostics)
+        {
+            if (out_dev_nums != NULL)
+                fill_dev_num(ctx, device->name, &out_dev_nums[count]);
+            out_contexts[count++] = ctx;
+            continue;
+        }
+
+        ctx->config = device->config;
+        if (claim_pins(ctx) != 0)
+        {
+            DMOD_LOG_ERROR("Skipping GPIO device [%s]\n", device->name);
+            Dmod_Free(ctx);
+            continue;
+        }
+        ctx->interrupt_handler_name = (device->interrupt_handler != NULL)
+            ? Dmod_StrDup(device->interrupt_handler) : NULL;
+        if ((ctx->config.bus_width != 0U && new_bus_map(ctx) != 0) ||
+            register_interrupt_handler(ctx) != 0)
+        {
+            DMOD_LOG_ERROR("Skipping GPIO device [%s]\n", device->name);
+            release_pins(ctx);
+            Dmod_Free(ctx->interrupt_handler_name);
+            Dmod_Free(ctx->bus);
+            Dmod_Free(ctx);
+            continue;
+        }
+        if (!ctx->config.lazy &&
+            ctx->config.interrupt_trigger != dmgpio_int_trigger_off &&
+            ctx->config.interrupt_dispatch == dmgpio_int_dispatch_deferred &&
+            dmgpio_port_set_deferred_dispatch(ctx->config.port, 1) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to enable deferred interrupts for GPIO port %s\n",
+                port_to_string(ctx->config.port));
+            ctx->magic = 0;
+        }
+        if (!ctx->config.lazy &&
+            ctx->config.interrupt_trigger != dmgpio_int_trigger_off &&
+            ctx->config.debounce_us != 0U &&
+            dmgpio_port_set_debounce(ctx->config.port, ctx->config.pins, ctx->config.debounce_us) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to set debounce for GPIO port %s\n",
+                port_to_string(ctx->config.port));
+            ctx->magic = 0;
+        }
+        if (!ctx->config.lazy &&
+            ctx->config.interrupt_trigger != dmgpio_int_trigger_off &&
+            ctx->config.max_interrupt_rate != 0U &&
+            dmgpio_port_set_rate_limit(ctx->config.port, ctx->config.pins, ctx->config.max_interrupt_rate) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to set interrupt rate limit for GPIO port %s\n",
+                port_to_string(ctx->config.port));
+            ctx->magic = 0;
+        }
+        if (out_dev_nums != NULL)
+            fill_dev_num(ctx, device->name, &out_dev_nums[count]);
+        out_contexts[count++] = ctx;
+    }
+
+    /* Pass 2: power each port and write its image.  The images leave out
+     * lazy devices, which are configured on their first access. */
+    uint32_t ready_ports = 0;
+    for (size_t i = 0; i < board->image_count; i++)
+    {
+        const dmgpio_port_image_t *image = &board->images[i];
+        if (dmgpio_port_set_power(image->port, 1) != 0 || dmgpio_port_apply_image(image) != 0)
+        {
+            DMOD_LOG_ERROR("Failed to configure GPIO port %s\n", port_to_string(image->port));
+            continue;
+        }
+        ready_ports |= 1UL << image->port;
+    }
+
+    /* Drop the failed devices and compact the output arrays. */
+    size_t created = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        dmdrvi_context_t ctx          = out_contexts[i];
+        uint32_t         device_ports = spanned_ports(&ctx->config);
+        if (!is_valid_context(ctx) ||
+            (!ctx->config.lazy && (ready_ports & device_ports) != device_ports))
+        {
+            DMOD_LOG_ERROR("Failed to configure GPIO P%s[0x%04X]\n",
+                port_to_string(ctx->config.port), (unsigned)ctx->config.pins);
+            delete_context(ctx);
+            continue;
+        }
+        if (!ctx->config.lazy)
+            mark_configured(ctx);
+        out_contexts[created] = ctx;
+        if (out_dev_nums != NULL)
+            out_dev_nums[created] = out_dev_nums[i];
+        created++;
+    }
+    return (int)created;
+}
+
+dmod_dmgpio_api_declaration(1.0, dmdrvi_context_t, _get_pin_owner,
+    ( dmgpio_port_t port, dmgpio_pin_t pin ))
+{
+    void *owner = NULL;
+    if (dmgpio_port_read_pin_owner(port, pin, &owner) != 0)
+        return NULL;
+    return (dmdrvi_context_t)owner;
+}
+
+dmod_dmgpio_api_declaration(1.0, int, _get_stats,
+    ( dmdrvi_context_t context, dmgpio_device_stats_t *out_stats ))
+{
+    if (!is_valid_context(context) || out_stats == NULL)
+        return -EINVAL;
+    read_device_stats(context, out_stats);
     return 0;
-}
\ No newline at end of file
+}
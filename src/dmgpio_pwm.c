@@ -0,0 +1,295 @@
+#include "dmod.h"
+#include "dmgpio_pwm.h"
+#include "dmgpio_port.h"
+#include <errno.h>
+#include <string.h>
+
+/* Magic set to DPWM */
+#define DMGPIO_PWM_MAGIC            0x4450574D
+
+/**
+ * @brief Writes of a schedule: one per port at the period start and at
+ *        most one per channel for the falling edges.
+ */
+#define DMGPIO_PWM_MAX_WRITES       (2U * DMGPIO_PWM_MAX_CHANNELS)
+
+/** state: index of the schedule used by dmgpio_pwm_tick */
+#define DMGPIO_PWM_STATE_ACTIVE     (1U << 0)
+/** state: the other schedule is complete and waits for the period boundary */
+#define DMGPIO_PWM_STATE_PENDING    (1U << 1)
+
+/**
+ * @brief Pins of one port that share a duty cycle
+ */
+typedef struct
+{
+    dmgpio_port_t       port;   /**< GPIO port index */
+    dmgpio_pins_mask_t  pins;   /**< Pins driven by the channel */
+    uint32_t            duty;   /**< High time in ticks */
+} dmgpio_pwm_channel_t;
+
+/**
+ * @brief One BSRR store of a schedule
+ */
+typedef struct
+{
+    uint32_t            time;   /**< Tick within the period */
+    dmgpio_port_t       port;   /**< GPIO port index */
+    dmgpio_pins_mask_t  set;    /**< Pins driven high */
+    dmgpio_pins_mask_t  reset;  /**< Pins driven low */
+} dmgpio_pwm_write_t;
+
+/**
+ * @brief Stores of one period, sorted by time; at most one per port and time.
+ */
+typedef struct
+{
+    size_t              count;
+    dmgpio_pwm_write_t  writes[DMGPIO_PWM_MAX_WRITES];
+} dmgpio_pwm_schedule_t;
+
+/**
+ * @brief Software PWM engine
+ *
+ * The channels and the inactive schedule belong to the updating context;
+ * counter, next and current belong to dmgpio_pwm_tick.  The two only meet
+ * in state, which hands a finished schedule over at the period boundary.
+ */
+struct dmgpio_pwm
+{
+    uint32_t                     magic;         /**< Magic number for validation */
+    uint32_t                     period;        /**< Ticks per period */
+    uint32_t                     counter;       /**< Tick within the current period */
+    size_t                       next;          /**< Next write of the current schedule */
+    const dmgpio_pwm_schedule_t *current;       /**< Schedule of the current period */
+    uint32_t                     state;         /**< DMGPIO_PWM_STATE_* */
+    size_t                       channel_count; /**< Number of channels */
+    dmgpio_pwm_channel_t         channels[DMGPIO_PWM_MAX_CHANNELS];
+    dmgpio_pwm_schedule_t        schedules[2];
+};
+
+static int is_valid_pwm(dmgpio_pwm_t pwm)
+{
+    return (pwm != NULL && pwm->magic == DMGPIO_PWM_MAGIC);
+}
+
+/**
+ * @brief Check that every pin of @p pins belongs to a device and is
+ *        configured as an output.
+ */
+static bool are_configured_outputs(dmgpio_port_t port, dmgpio_pins_mask_t pins)
+{
+    for (dmgpio_pin_t pin = 0; pin < 16U; pin++)
+    {
+        dmgpio_pins_mask_t mask = (dmgpio_pins_mask_t)(1U << pin);
+        int used = 0;
+        dmgpio_mode_t mode;
+        if ((pins & mask) == 0U)
+            continue;
+        if (dmgpio_port_check_is_pin_used(port, mask, &used) != 0 || !used ||
+            dmgpio_port_read_mode(port, mask, &mode) != 0 || mode != dmgpio_mode_output)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Add @p pins of @p port to the write at @p time, keeping the falling
+ *        edges in [first, count) sorted by time and port.
+ */
+static void add_reset_edge(dmgpio_pwm_schedule_t *s, size_t first, uint32_t time,
+                           dmgpio_port_t port, dmgpio_pins_mask_t pins)
+{
+    size_t pos = first;
+    while (pos < s->count &&
+           (s->writes[pos].time < time || (s->writes[pos].time == time && s->writes[pos].port < port)))
+        pos++;
+
+    if (pos < s->count && s->writes[pos].time == time && s->writes[pos].port == port)
+    {
+        s->writes[pos].reset |= pins;
+        return;
+    }
+    memmove(&s->writes[pos + 1U], &s->writes[pos], (s->count - pos) * sizeof(s->writes[0]));
+    s->writes[pos].time  = time;
+    s->writes[pos].port  = port;
+    s->writes[pos].set   = 0U;
+    s->writes[pos].reset = pins;
+    s->count++;
+}
+
+/**
+ * @brief Compute the schedule of the current channel duties into @p s.
+ *
+ * Every port with a channel gets one write at tick 0 that drives its
+ * active channels high and its zero-duty channels low.  Each channel with
+ * 0 < duty < period then goes low at tick duty, merged with the other
+ * channels of its port that end at the same tick.
+ */
+static void build_schedule(dmgpio_pwm_t pwm, dmgpio_pwm_schedule_t *s)
+{
+    s->count = 0U;
+    for (size_t i = 0; i < pwm->channel_count; i++)
+    {
+        const dmgpio_pwm_channel_t *c = &pwm->channels[i];
+        size_t w = 0;
+        while (w < s->count && s->writes[w].port != c->port)
+            w++;
+        if (w == s->count)
+        {
+            s->writes[w].time  = 0U;
+            s->writes[w].port  = c->port;
+            s->writes[w].set   = 0U;
+            s->writes[w].reset = 0U;
+            s->count++;
+        }
+        if (c->duty > 0U)
+            s->writes[w].set   |= c->pins;
+        else
+            s->writes[w].reset |= c->pins;
+    }
+
+    size_t starts = s->count;
+    for (size_t i = 0; i < pwm->channel_count; i++)
+    {
+        const dmgpio_pwm_channel_t *c = &pwm->channels[i];
+        if (c->duty > 0U && c->duty < pwm->period)
+            add_reset_edge(s, starts, c->duty, c->port, c->pins);
+    }
+}
+
+/**
+ * @brief Rebuild the inactive schedule and hand it to dmgpio_pwm_tick.
+ *
+ * Withdrawing a pending schedule first guarantees that the tick cannot
+ * switch to the buffer while it is rewritten; if the tick has just taken
+ * it, the fetch returns the new active index and the other buffer is used.
+ */
+static void publish_schedule(dmgpio_pwm_t pwm)
+{
+    uint32_t state = __atomic_fetch_and(&pwm->state, ~DMGPIO_PWM_STATE_PENDING, __ATOMIC_ACQ_REL);
+    build_schedule(pwm, &pwm->schedules[(state & DMGPIO_PWM_STATE_ACTIVE) ^ 1U]);
+    __atomic_fetch_or(&pwm->state, DMGPIO_PWM_STATE_PENDING, __ATOMIC_RELEASE);
+}
+
+dmod_dmgpio_api_declaration(1.0, dmgpio_pwm_t, _pwm_create, ( uint32_t period_ticks ))
+{
+    if (period_ticks < 2U)
+    {
+        DMOD_LOG_ERROR("Invalid PWM period: %u ticks\n", (unsigned)period_ticks);
+        return NULL;
+    }
+
+    dmgpio_pwm_t pwm = (dmgpio_pwm_t)Dmod_Malloc(sizeof(struct dmgpio_pwm));
+    if (pwm == NULL)
+    {
+        DMOD_LOG_ERROR("Failed to allocate PWM engine\n");
+        return NULL;
+    }
+
+    memset(pwm, 0, sizeof(struct dmgpio_pwm));
+    pwm->magic   = DMGPIO_PWM_MAGIC;
+    pwm->period  = period_ticks;
+    pwm->current = &pwm->schedules[0];
+    return pwm;
+}
+
+dmod_dmgpio_api_declaration(1.0, void, _pwm_free, ( dmgpio_pwm_t pwm ))
+{
+    if (!is_valid_pwm(pwm))
+        return;
+
+    for (size_t i = 0; i < pwm->channel_count; i++)
+        dmgpio_port_write_data(pwm->channels[i].port, pwm->channels[i].pins, 0U);
+    pwm->magic = 0;
+    Dmod_Free(pwm);
+}
+
+dmod_dmgpio_api_declaration(1.0, int, _pwm_add_channel,
+    ( dmgpio_pwm_t pwm, dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t duty ))
+{
+    if (!is_valid_pwm(pwm) || pins == 0U || duty > pwm->period)
+        return -EINVAL;
+    if (!are_configured_outputs(port, pins))
+    {
+        DMOD_LOG_ERROR("GPIO P%c[0x%04X] is not an output of a configured device\n",
+            'A' + port, (unsigned)pins);
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < pwm->channel_count; i++)
+    {
+        if (pwm->channels[i].port == port && (pwm->channels[i].pins & pins) != 0U)
+        {
+            DMOD_LOG_ERROR("GPIO P%c[0x%04X] is already driven by PWM channel %u\n",
+                'A' + port, (unsigned)(pwm->channels[i].pins & pins), (unsigned)i);
+            return -EBUSY;
+        }
+    }
+    if (pwm->channel_count == DMGPIO_PWM_MAX_CHANNELS)
+        return -ENOMEM;
+
+    dmgpio_pwm_channel_t *c = &pwm->channels[pwm->channel_count];
+    c->port = port;
+    c->pins = pins;
+    c->duty = duty;
+    pwm->channel_count++;
+    publish_schedule(pwm);
+    return (int)(pwm->channel_count - 1U);
+}
+
+dmod_dmgpio_api_declaration(1.0, int, _pwm_set_duty, ( dmgpio_pwm_t pwm, int channel, uint32_t duty ))
+{
+    return dmgpio_pwm_set_duties(pwm, channel, &duty, 1U);
+}
+
+dmod_dmgpio_api_declaration(1.0, int, _pwm_set_duties,
+    ( dmgpio_pwm_t pwm, int first, const uint32_t *duties, size_t count ))
+{
+    if (!is_valid_pwm(pwm) || duties == NULL || first < 0 ||
+        (size_t)first > pwm->channel_count || count > pwm->channel_count - (size_t)first)
+        return -EINVAL;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (duties[i] > pwm->period)
+            return -EINVAL;
+    }
+    for (size_t i = 0; i < count; i++)
+        pwm->channels[(size_t)first + i].duty = duties[i];
+    publish_schedule(pwm);
+    return 0;
+}
+
+dmod_dmgpio_api_declaration(1.0, void, _pwm_tick, ( dmgpio_pwm_t pwm ))
+{
+    uint32_t counter = pwm->counter;
+    size_t   next    = pwm->next;
+
+    if (counter == 0U)
+    {
+        /* Period boundary: take over a pending schedule.  The exchange
+         * fails only if an update withdrew it meanwhile, which leaves the
+         * active index as it was. */
+        uint32_t state = __atomic_load_n(&pwm->state, __ATOMIC_ACQUIRE);
+        if ((state & DMGPIO_PWM_STATE_PENDING) != 0U)
+        {
+            uint32_t active = (state & DMGPIO_PWM_STATE_ACTIVE) ^ 1U;
+            if (__atomic_compare_exchange_n(&pwm->state, &state, active, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                pwm->current = &pwm->schedules[active];
+        }
+        next = 0U;
+    }
+
+    const dmgpio_pwm_schedule_t *s = pwm->current;
+    while (next < s->count && s->writes[next].time == counter)
+    {
+        const dmgpio_pwm_write_t *w = &s->writes[next];
+        dmgpio_port_write_data(w->port, w->set | w->reset, w->set);
+        next++;
+    }
+
+    pwm->next    = next;
+    pwm->counter = (counter + 1U == pwm->period) ? 0U : counter + 1U;
+}
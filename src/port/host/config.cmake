@@ -0,0 +1,3 @@
+# Host simulation: built with the native toolchain (DMOD default).  The STM32
+# register blocks are kept in ordinary memory by src/port/host/port.c.
+set(DMGPIO_PORT_DEFINITIONS STM32_HOST_SIMULATION)
@@ -0,0 +1,47 @@
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include "dmgpio_types.h"
+
+/**
+ * @brief Reset every simulated register (GPIO, EXTI, SYSCFG, RCC, NVIC, DWT) to zero.
+ *
+ * The DWT cycle counter does not run on the host; callers that want
+ * distinct event timestamps or expiring debounce windows write
+ * stm32_host_dwt_cyccnt themselves.  With RCC at reset the core clock is
+ * the 16 MHz HSI, so 1 us of debounce window is 16 cycles.
+ */
+void host_port_reset(void);
+
+/**
+ * @brief Apply the last BSRR write of a port to its ODR and mirror the
+ *        output pins into IDR.
+ *
+ * On hardware BSRR is a write-only register that updates ODR as a side
+ * effect.  In the simulation it is plain memory, so callers that need the
+ * pin state to follow the writes (e.g. before a toggle or a read-back)
+ * must call this after each write.
+ *
+ * @param port GPIO port index (0=A, 1=B, ...).
+ */
+void host_port_sync_outputs(dmgpio_port_t port);
+
+/**
+ * @brief Drive an input pin to a new level and raise the EXTI interrupt if
+ *        the resulting edge is enabled.
+ *
+ * Updates IDR, and when the EXTI line of @p pin is routed to @p port,
+ * unmasked in IMR and the edge matches RTSR/FTSR, sets the line in PR and
+ * calls stm32_gpio_exti_irq_handler() with the line mask of the ISR that
+ * serves it on target (EXTI0..4, EXTI9_5 or EXTI15_10).
+ *
+ * @param port  GPIO port index (0=A, 1=B, ...).
+ * @param pin   Pin number (0-15).
+ * @param level New pin level (0 = low, non-zero = high).
+ *
+ * @return 1 if an interrupt was dispatched, 0 if no enabled edge occurred,
+ *         -1 on invalid arguments.
+ */
+int host_port_inject_edge(dmgpio_port_t port, dmgpio_pin_t pin, int level);
+
+#endif // HOST_PORT_H
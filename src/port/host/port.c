@@ -0,0 +1,139 @@
+#define DMOD_ENABLE_REGISTRATION    ON
+#include "dmod.h"
+#include "dmgpio_port.h"
+#include "host_port.h"
+#include "../stm32_common/stm32_common.h"
+#include <string.h>
+
+/* ======================================================================
+ *  Simulated register blocks (see STM32_HOST_SIMULATION in stm32_common.h)
+ * ====================================================================== */
+
+stm32_gpio_t      stm32_host_gpio[STM32_MAX_PORTS];
+stm32_exti_t      stm32_host_exti;
+volatile uint32_t stm32_host_rcc_pllcfgr;
+volatile uint32_t stm32_host_rcc_cfgr;
+volatile uint32_t stm32_host_rcc_ahb1enr;
+volatile uint32_t stm32_host_rcc_apb2enr;
+volatile uint32_t stm32_host_syscfg_exticr[4];
+volatile uint32_t stm32_host_nvic_iser[8];
+volatile uint32_t stm32_host_nvic_icer[8];
+volatile uint32_t stm32_host_demcr;
+volatile uint32_t stm32_host_dwt_ctrl;
+volatile uint32_t stm32_host_dwt_cyccnt;
+volatile uint32_t stm32_host_dwt_lar;
+uint8_t           stm32_host_locks[STM32_MAX_PORTS + 1U];
+
+/**
+ * @brief Initialize the DMDRVI module
+ * 
+ * @param Config Pointer to Dmod_Config_t structure with configuration parameters
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+int dmod_init(const Dmod_Config_t *Config)
+{
+    host_port_reset();
+    Dmod_Printf("DMGPIO Port module initialized (host simulation)\n");
+    return 0;
+}
+
+/**
+ * @brief Deinitialize the DMDRVI module
+ * 
+ * @return int 0 on success, non-zero on failure
+ */
+int dmod_deinit(void)
+{
+    Dmod_Printf("DMGPIO Port module deinitialized (host simulation)\n");
+    return 0;
+}
+
+/* ======================================================================
+ *  Simulation control
+ * ====================================================================== */
+
+/**
+ * @brief Return the EXTI line mask served by the ISR that handles @p pin.
+ *
+ * Mirrors the DMOD_IRQ_HANDLER table of the STM32 ports.
+ */
+static uint32_t exti_isr_lines(dmgpio_pin_t pin)
+{
+    if (pin <= 4U) return 1UL << pin;   /* EXTI0 .. EXTI4 */
+    if (pin <= 9U) return 0x03E0UL;     /* EXTI9_5 */
+    return 0xFC00UL;                    /* EXTI15_10 */
+}
+
+void host_port_reset(void)
+{
+    memset((void *)stm32_host_gpio, 0, sizeof(stm32_host_gpio));
+    memset((void *)&stm32_host_exti, 0, sizeof(stm32_host_exti));
+    memset((void *)stm32_host_syscfg_exticr, 0, sizeof(stm32_host_syscfg_exticr));
+    memset((void *)stm32_host_nvic_iser, 0, sizeof(stm32_host_nvic_iser));
+    memset((void *)stm32_host_nvic_icer, 0, sizeof(stm32_host_nvic_icer));
+    stm32_host_rcc_pllcfgr = 0U;
+    stm32_host_rcc_cfgr    = 0U;
+    stm32_host_rcc_ahb1enr = 0U;
+    stm32_host_rcc_apb2enr = 0U;
+    stm32_host_demcr       = 0U;
+    stm32_host_dwt_ctrl    = 0U;
+    stm32_host_dwt_cyccnt  = 0U;
+    stm32_host_dwt_lar     = 0U;
+}
+
+void host_port_sync_outputs(dmgpio_port_t port)
+{
+    if ((uint32_t)port >= STM32_MAX_PORTS) return;
+    stm32_gpio_t *gpio = &stm32_host_gpio[port];
+
+    /* BSRR: lower half sets, upper half resets; set wins when both are given. */
+    uint32_t bsrr = gpio->BSRR;
+    uint32_t odr  = gpio->ODR;
+    odr &= ~(bsrr >> 16U);
+    odr |=  (bsrr & 0xFFFFU);
+    gpio->ODR  = odr & 0xFFFFU;
+    gpio->BSRR = 0U;
+
+    /* Output pins (MODER == 01) read back their driven level. */
+    uint32_t output_pins = 0U;
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        if (((gpio->MODER >> (pin * 2U)) & 3U) == 1U)
+            output_pins |= 1UL << pin;
+    }
+    gpio->IDR = (gpio->IDR & ~output_pins) | (gpio->ODR & output_pins);
+}
+
+int host_port_inject_edge(dmgpio_port_t port, dmgpio_pin_t pin, int level)
+{
+    if ((uint32_t)port >= STM32_MAX_PORTS || pin > 15U) return -1;
+
+    stm32_gpio_t *gpio     = &stm32_host_gpio[port];
+    uint32_t      pin_mask = 1UL << pin;
+    uint32_t      previous = gpio->IDR & pin_mask;
+    uint32_t      current  = level ? pin_mask : 0U;
+
+    gpio->IDR = (gpio->IDR & ~pin_mask) | current;
+    if (previous == current) return 0;
+
+    /* The edge only reaches EXTI when SYSCFG routes this port to the line. */
+    uint32_t exticr_idx   = (uint32_t)pin / 4U;
+    uint32_t exticr_shift = ((uint32_t)pin % 4U) * 4U;
+    if (((stm32_host_syscfg_exticr[exticr_idx] >> exticr_shift) & 0xFU) != (uint32_t)port)
+        return 0;
+
+    uint32_t trigger = current ? stm32_host_exti.RTSR : stm32_host_exti.FTSR;
+    if (!(stm32_host_exti.IMR & pin_mask) || !(trigger & pin_mask))
+        return 0;
+
+    /* NVIC enable state is not modelled: ISER/ICER are write-1-to-act
+     * registers and cannot be represented by plain memory. */
+    stm32_host_exti.PR |= pin_mask;
+    stm32_gpio_exti_irq_handler(exti_isr_lines(pin));
+
+    /* On hardware writing 1 to PR clears the bit; emulate that here since
+     * the common handler writes the pending mask back to PR. */
+    stm32_host_exti.PR &= ~pin_mask;
+    return 1;
+}
@@ -1,26 +1,178 @@
+#include "dmod.h"
 #include "stm32_common.h"
 #include <stddef.h>
 
 /* ---- Software state ---- */
 
-/** Bitmask of pins currently in use, indexed by port number. */
+/** Bitmask of pins currently in use, indexed by port number.
+ *  Only changed with atomic operations, so devices can be created and freed
+ *  from several tasks without a lock. */
 static dmgpio_pins_mask_t s_pins_used[STM32_MAX_PORTS] = {0};
 
-/** Maximum number of interrupt handlers that can be registered per port.
- *  Each dmgpio context that uses interrupts on a given port occupies one slot.
- *  Increase this value if more than 8 contexts share the same port. */
-#define STM32_PORT_MAX_IRQ_HANDLERS  8U
+/** Owner passed to _claim_pins for each used pin (NULL = none). */
+static void *s_pin_owners[STM32_MAX_PORTS][16];
 
-/** Per-port interrupt handler entry (handler function + opaque user pointer). */
-typedef struct
+/** Number of registry entries allocated at once when the pool runs dry. */
+#define STM32_IRQ_POOL_CHUNK_ENTRIES    8U
+
+/** Interrupt handler registry entry (handler function + opaque user pointer). */
+typedef struct stm32_port_irq_entry
 {
     dmgpio_port_interrupt_handler_t handler;
     void                           *user_ptr;
+    struct stm32_port_irq_entry    *next;
     dmgpio_pins_mask_t              pins;
 } stm32_port_irq_entry_t;
 
-/** Per-port arrays of registered interrupt handlers. */
-static stm32_port_irq_entry_t s_port_handlers[STM32_MAX_PORTS][STM32_PORT_MAX_IRQ_HANDLERS];
+/** Per-port lists of registered interrupt handlers, in registration order.
+ *  Ports that never register a handler cost one pointer. */
+static stm32_port_irq_entry_t *s_port_handlers[STM32_MAX_PORTS];
+
+/** Link field of the last entry of each list (NULL = list is empty, use the head). */
+static stm32_port_irq_entry_t **s_port_handlers_tail[STM32_MAX_PORTS];
+
+/** Length of each list, so _read_diagnostics can report it without a full walk. */
+static uint32_t s_port_handler_count[STM32_MAX_PORTS];
+
+/** Entries returned by _remove_interrupt_handler, reused before the pool grows. */
+static stm32_port_irq_entry_t *s_irq_free_entries;
+
+/** Marks an EXTI line that is not routed to any port in s_exti_line_port. */
+#define STM32_EXTI_LINE_UNMAPPED    0xFFU
+
+/** Software copy of the SYSCFG_EXTICR routing: EXTI line -> GPIO port.
+ *  Kept in sync by _set_interrupt_trigger so the ISR needs no EXTICR reads. */
+static uint8_t s_exti_line_port[16] = {
+    STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED,
+    STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED,
+    STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED,
+    STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED, STM32_EXTI_LINE_UNMAPPED,
+};
+
+/** Number of events the deferred ring holds (must be a power of two). */
+#ifndef STM32_DEFERRED_RING_SIZE
+#define STM32_DEFERRED_RING_SIZE    64U
+#endif
+
+_Static_assert((STM32_DEFERRED_RING_SIZE & (STM32_DEFERRED_RING_SIZE - 1U)) == 0U,
+    "STM32_DEFERRED_RING_SIZE must be a power of two");
+
+/** One interrupt recorded by the ISR for deferred dispatch. */
+typedef struct
+{
+    uint32_t           timestamp;   /**< stm32_timestamp() at ISR entry */
+    dmgpio_port_t      port;
+    dmgpio_pins_mask_t pins;        /**< Pins whose EXTI lines were pending */
+    dmgpio_pins_mask_t state;       /**< IDR & pins, sampled in the ISR */
+} stm32_exti_event_t;
+
+/** Ring of interrupts waiting for _process_deferred_interrupts.  The ISR
+ *  produces at s_deferred_head, the worker consumes at s_deferred_tail;
+ *  both indices run freely and are masked on access. */
+static stm32_exti_event_t s_deferred_ring[STM32_DEFERRED_RING_SIZE];
+static uint32_t           s_deferred_head;
+static uint32_t           s_deferred_tail;
+
+/** Events dropped because the ring was full. */
+static uint32_t s_deferred_overflows;
+
+/** Bit N set = interrupts on port N are queued instead of dispatched in the ISR. */
+static uint32_t s_deferred_ports;
+
+/** Timestamp of the event whose handlers are currently running. */
+static uint32_t s_event_timestamp;
+
+/** Interrupts taken per EXTI line, whatever happened to them afterwards. */
+static uint32_t s_exti_line_interrupts[16];
+
+_Static_assert(STM32_MAX_PORTS <= DMGPIO_DIAG_PORTS, "dmgpio_diagnostics_t must cover every port");
+
+/** Debounce window of each EXTI line in stm32_timestamp() cycles (0 = none). */
+static uint32_t s_debounce_cycles[16];
+
+/** Bit N set = line N has a debounce window. */
+static uint32_t s_debounce_lines;
+
+/** Bit N set = line N is masked after an edge until its window expires.
+ *  Changed under the shared lock, read by the worker without it. */
+static uint32_t s_debounce_waiting;
+
+/** stm32_timestamp() at which each waiting line is sampled again. */
+static uint32_t s_debounce_deadline[16];
+
+/** Level of each debounced line before its current burst (bit N = line N
+ *  high): the last settled level, or for a one-edge trigger the level the
+ *  edge left, since the return edge raises no interrupt. */
+static uint32_t s_debounce_level;
+
+/** Bit N set = s_debounce_level holds a level of line N.  Cleared when the
+ *  window is set, since the pull-ups may not be configured yet; the first
+ *  settled level then counts as a change. */
+static uint32_t s_debounce_known;
+
+/** Rate-limit windows per second: budgets are counted per window and a
+ *  throttled line is polled once per window. */
+#ifndef STM32_RATE_WINDOWS_PER_SECOND
+#define STM32_RATE_WINDOWS_PER_SECOND   10U
+#endif
+
+/** Longest time a throttled line stays masked, in windows. */
+#define STM32_RATE_MAX_BACKOFF          64U
+
+/** Interrupt rate accounting of one EXTI line. */
+typedef struct
+{
+    uint32_t budget;        /**< Interrupts allowed per window (0 = no limit) */
+    uint32_t count;         /**< Interrupts in the current window */
+    uint32_t window_start;  /**< stm32_timestamp() at the start of the window */
+    uint32_t masked_at;     /**< stm32_timestamp() when the line was throttled */
+    uint32_t polled_at;     /**< stm32_timestamp() of the last poll */
+    uint32_t backoff;       /**< Windows the line stays masked when throttled */
+    uint32_t storms;        /**< Times the line was throttled */
+    uint32_t polled_events; /**< Events dispatched by polling while throttled */
+} stm32_rate_limit_t;
+
+static stm32_rate_limit_t s_rate[16];
+
+/** Length of a rate-limit window in stm32_timestamp() cycles. */
+static uint32_t s_rate_window_cycles;
+
+/** Bit N set = line N has a rate limit. */
+static uint32_t s_rate_lines;
+
+/** Bit N set = line N exceeded its budget and is masked and polled.
+ *  Changed under the shared lock, read by the worker without it. */
+static uint32_t s_rate_throttled;
+
+/** Bit N set = line N was unmasked after throttling less than one window
+ *  ago; throttling it again then doubles its backoff. */
+static uint32_t s_rate_rearmed;
+
+/** Level of each throttled line at its last poll (bit N = line N high). */
+static uint32_t s_rate_level;
+
+/** Configuration registers staged by a configuration session, in commit order. */
+typedef enum
+{
+    STM32_CFG_OTYPER = 0,
+    STM32_CFG_OSPEEDR,
+    STM32_CFG_PUPDR,
+    STM32_CFG_AFRL,
+    STM32_CFG_AFRH,
+    STM32_CFG_MODER,    /* last: pins only change direction once the rest is in place */
+    STM32_CFG_COUNT
+} stm32_cfg_reg_t;
+
+/** Shadow image of a port's configuration registers during a session. */
+typedef struct
+{
+    uint32_t depth;                     /**< Nesting of _begin_configuration calls */
+    uint32_t loaded;                    /**< Bit per stm32_cfg_reg_t: value[] holds the register */
+    uint32_t dirty;                     /**< Bit per stm32_cfg_reg_t: value[] must be written back */
+    uint32_t value[STM32_CFG_COUNT];
+} stm32_config_shadow_t;
+
+static stm32_config_shadow_t s_config_shadow[STM32_MAX_PORTS];
 
 /* ---- Internal helpers ---- */
 
@@ -29,45 +181,123 @@ static int is_valid_port(dmgpio_port_t port)
     return ((uint32_t)port < STM32_MAX_PORTS);
 }
 
+static volatile uint32_t *cfg_hw_reg(dmgpio_port_t port, stm32_cfg_reg_t reg)
+{
+    volatile stm32_gpio_t *gpio = STM32_GPIO(port);
+    switch (reg)
+    {
+        case STM32_CFG_OTYPER:  return &gpio->OTYPER;
+        case STM32_CFG_OSPEEDR: return &gpio->OSPEEDR;
+        case STM32_CFG_PUPDR:   return &gpio->PUPDR;
+        case STM32_CFG_AFRL:    return &gpio->AFR[0];
+        case STM32_CFG_AFRH:    return &gpio->AFR[1];
+        default:                return &gpio->MODER;
+    }
+}
+
+/**
+ * @brief Read a configuration register, from the shadow image while a
+ *        configuration session is open on @p port.
+ *
+ * The hardware register is read at most once per session.  Callers hold
+ * stm32_lock(port), as for cfg_write().
+ */
+static uint32_t cfg_read(dmgpio_port_t port, stm32_cfg_reg_t reg)
+{
+    stm32_config_shadow_t *shadow = &s_config_shadow[port];
+    if (shadow->depth == 0U)
+        return *cfg_hw_reg(port, reg);
+    if (!(shadow->loaded & (1U << reg)))
+    {
+        shadow->value[reg] = *cfg_hw_reg(port, reg);
+        shadow->loaded    |= 1U << reg;
+    }
+    return shadow->value[reg];
+}
+
+/**
+ * @brief Write a configuration register, or stage the value in the shadow
+ *        image while a configuration session is open on @p port.
+ *
+ * Must follow a cfg_read() of the same register (all callers do a
+ * read-modify-write), so the shadow value is loaded.
+ */
+static void cfg_write(dmgpio_port_t port, stm32_cfg_reg_t reg, uint32_t value)
+{
+    stm32_config_shadow_t *shadow = &s_config_shadow[port];
+    if (shadow->depth == 0U)
+    {
+        *cfg_hw_reg(port, reg) = value;
+        return;
+    }
+    if (shadow->value[reg] != value)
+    {
+        shadow->value[reg] = value;
+        shadow->dirty     |= 1U << reg;
+    }
+}
+
 /**
  * @brief Write a 2-bit value into each selected pin field of a register.
  *
  * Each pin occupies two consecutive bits starting at bit (pin * 2).
  *
- * @param reg   Target register pointer.
+ * @param port  GPIO port index.
+ * @param reg   Target configuration register.
  * @param pins  Bitmask selecting which pins to update.
  * @param value 2-bit value (0–3) to write for every selected pin.
  */
-static void set_2bit_fields(volatile uint32_t *reg, dmgpio_pins_mask_t pins, uint32_t value)
+static void set_2bit_fields(dmgpio_port_t port, stm32_cfg_reg_t reg, dmgpio_pins_mask_t pins, uint32_t value)
 {
-    uint32_t val = *reg;
+    /* Fields are computed outside the section, which only spans the access */
+    uint32_t mask = 0U;
+    uint32_t bits = 0U;
     for (int pin = 0; pin < 16; pin++)
     {
         if (pins & (dmgpio_pins_mask_t)(1U << pin))
         {
             uint32_t shift = (uint32_t)pin * 2U;
-            val &= ~(3U << shift);
-            val |= (value & 3U) << shift;
+            mask |= 3U << shift;
+            bits |= (value & 3U) << shift;
         }
     }
-    *reg = val;
+    uint32_t key = stm32_lock(port);
+    cfg_write(port, reg, (cfg_read(port, reg) & ~mask) | bits);
+    stm32_unlock(port, key);
 }
 
 /**
  * @brief Read the 2-bit field of the lowest set pin in a register.
  *
- * @param reg  Source register pointer.
+ * @param port GPIO port index.
+ * @param reg  Source configuration register.
  * @param pins Bitmask; the lowest set bit selects the pin to read.
  * @return The 2-bit field value (0–3), or 0 if @p pins is empty.
  */
-static uint32_t read_2bit_field(volatile const uint32_t *reg, dmgpio_pins_mask_t pins)
+static uint32_t read_2bit_field(dmgpio_port_t port, stm32_cfg_reg_t reg, dmgpio_pins_mask_t pins)
 {
-    for (int pin = 0; pin < 16; pin++)
-    {
-        if (pins & (dmgpio_pins_mask_t)(1U << pin))
-            return (*reg >> ((uint32_t)pin * 2U)) & 3U;
-    }
-    return 0U;
+    if (pins == 0U)
+        return 0U;
+    uint32_t key = stm32_lock(port);
+    uint32_t val = cfg_read(port, reg);
+    stm32_unlock(port, key);
+    return (val >> ((uint32_t)__builtin_ctz(pins) * 2U)) & 3U;
+}
+
+/**
+ * @brief Write bit @p bit of a peripheral register to @p value (0 or 1).
+ *
+ * With bit-banding (STM32_BIT_BAND, Cortex-M4) this is a single store to
+ * the alias word, which is atomic and does not read the register.
+ * Otherwise it is a read-modify-write, made under the caller's stm32_lock().
+ */
+static inline void reg_write_bit(volatile uint32_t *reg, uint32_t bit, uint32_t value)
+{
+#if defined(STM32_BIT_BAND_ALIAS)
+    *STM32_BIT_BAND_ALIAS(reg, bit) = value;
+#else
+    *reg = (*reg & ~(1U << bit)) | (value << bit);
+#endif
 }
 
 /* ---- NVIC helpers ---- */
@@ -100,34 +330,106 @@ static uint32_t exti_pin_to_irqn(int pin)
  *  Driver interrupt handler
  * ====================================================================== */
 
+/**
+ * @brief Take an entry from the free list, growing the pool if it is empty.
+ *
+ * Only called from thread context (_add_interrupt_handler); the ISR never
+ * allocates.  The free list is shared by all ports, so it is only touched
+ * under STM32_LOCK_SHARED; the chunk itself is allocated outside the lock.
+ * Pool chunks are never returned to the heap, so an entry pointer stays
+ * valid for the lifetime of the module.
+ */
+static stm32_port_irq_entry_t *alloc_irq_entry(void)
+{
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    stm32_port_irq_entry_t *entry = s_irq_free_entries;
+    if (entry != NULL)
+        s_irq_free_entries = entry->next;
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    if (entry != NULL) return entry;
+
+    stm32_port_irq_entry_t *chunk = (stm32_port_irq_entry_t *)Dmod_Malloc(
+        sizeof(stm32_port_irq_entry_t) * STM32_IRQ_POOL_CHUNK_ENTRIES);
+    if (chunk == NULL) return NULL;
+    for (uint32_t i = 1; i < STM32_IRQ_POOL_CHUNK_ENTRIES - 1U; i++)
+        chunk[i].next = &chunk[i + 1U];
+    key = stm32_lock(STM32_LOCK_SHARED);
+    chunk[STM32_IRQ_POOL_CHUNK_ENTRIES - 1U].next = s_irq_free_entries;
+    s_irq_free_entries = &chunk[1];
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    return &chunk[0];
+}
+
 dmod_dmgpio_port_api_declaration(1.0, int, _add_interrupt_handler,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_port_interrupt_handler_t handler, void *user_ptr ))
 {
     if (!is_valid_port(port) || handler == NULL) return -1;
-    for (uint8_t i = 0; i < STM32_PORT_MAX_IRQ_HANDLERS; i++)
-    {
-        if (s_port_handlers[port][i].handler == NULL)
-        {
-            s_port_handlers[port][i].handler  = handler;
-            s_port_handlers[port][i].user_ptr = user_ptr;
-            s_port_handlers[port][i].pins     = pins;
-            return 0;
-        }
-    }
-    return -1;
+    stm32_port_irq_entry_t *entry = alloc_irq_entry();
+    if (entry == NULL) return -1;
+    /* Handlers may read the timestamp of their event */
+    stm32_timestamp_enable();
+
+    entry->handler  = handler;
+    entry->user_ptr = user_ptr;
+    entry->pins     = pins;
+    entry->next     = NULL;
+
+    /* Append at the tail, under the port lock against other tasks adding
+     * or removing on the same port.  The entry is fully initialised before
+     * the release store that links it, so an ISR walking the list
+     * concurrently sees either the old tail or the complete new entry. */
+    uint32_t key = stm32_lock(port);
+    stm32_port_irq_entry_t **link = s_port_handlers_tail[port];
+    if (link == NULL)
+        link = &s_port_handlers[port];
+    __atomic_store_n(link, entry, __ATOMIC_RELEASE);
+    s_port_handlers_tail[port] = &entry->next;
+    s_port_handler_count[port]++;
+    stm32_unlock(port, key);
+    return 0;
 }
 
 dmod_dmgpio_port_api_declaration(1.0, int, _remove_interrupt_handler,
     ( dmgpio_port_t port, void *user_ptr ))
 {
     if (!is_valid_port(port)) return -1;
-    for (uint8_t i = 0; i < STM32_PORT_MAX_IRQ_HANDLERS; i++)
+    /* Each unlink is a single pointer store, so an ISR walking the list sees
+     * it either before or after the removal.  Once the store is done no ISR
+     * can still be on the removed entry (the ISR runs to completion before
+     * thread context resumes), so it can go straight to the free list.
+     * With deferred dispatch the same holds for the worker only if it does
+     * not run concurrently with this function: call both from one thread,
+     * or serialise them.  The entries are unlinked under the port lock and
+     * returned to the shared free list after it is released. */
+    stm32_port_irq_entry_t  *removed = NULL;
+    uint32_t                 key     = stm32_lock(port);
+    stm32_port_irq_entry_t **link    = &s_port_handlers[port];
+    while (*link != NULL)
     {
-        if (s_port_handlers[port][i].user_ptr == user_ptr)
+        stm32_port_irq_entry_t *entry = *link;
+        if (entry->user_ptr == user_ptr)
         {
-            s_port_handlers[port][i].handler = NULL;
+            __atomic_store_n(link, entry->next, __ATOMIC_RELEASE);
+            entry->next = removed;
+            removed     = entry;
+            s_port_handler_count[port]--;
+        }
+        else
+        {
+            link = &entry->next;
         }
     }
+    s_port_handlers_tail[port] = link;
+    stm32_unlock(port, key);
+
+    if (removed == NULL) return 0;
+    stm32_port_irq_entry_t *last = removed;
+    while (last->next != NULL)
+        last = last->next;
+    key = stm32_lock(STM32_LOCK_SHARED);
+    last->next         = s_irq_free_entries;
+    s_irq_free_entries = removed;
+    stm32_unlock(STM32_LOCK_SHARED, key);
     return 0;
 }
 
@@ -135,11 +437,47 @@ dmod_dmgpio_port_api_declaration(1.0, int, _remove_interrupt_handler,
  *  Configuration session
  * ====================================================================== */
 
+/*
+ * Between _begin_configuration and _finish_configuration the configuration
+ * setters and readers work on a shadow image of MODER, OTYPER, OSPEEDR,
+ * PUPDR and AFR.  Each register is read at most once when first touched
+ * and written at most once on commit, so no intermediate combination of
+ * settings ever reaches the pins.  Sessions on one port nest; the image is
+ * committed when the outermost session finishes.  Sessions opened by
+ * several tasks on one port share the image, and every access to it is
+ * made under stm32_lock(port), so the commit carries the settings of all
+ * of them.
+ */
+
+/**
+ * @brief Close one level of the session on @p port and commit the shadow
+ *        image when it was the outermost.  Called under stm32_lock(port).
+ */
+static void cfg_end_session(dmgpio_port_t port)
+{
+    stm32_config_shadow_t *shadow = &s_config_shadow[port];
+    if (--shadow->depth != 0U) return;
+
+    /* Commit in stm32_cfg_reg_t order: output type, speed, pull and
+     * alternate function first, MODER last, so a pin switches to output or
+     * alternate mode with its electrical settings already applied. */
+    for (uint32_t dirty = shadow->dirty; dirty != 0U; dirty &= dirty - 1U)
+    {
+        stm32_cfg_reg_t reg = (stm32_cfg_reg_t)__builtin_ctz(dirty);
+        *cfg_hw_reg(port, reg) = shadow->value[reg];
+    }
+    shadow->loaded = 0U;
+    shadow->dirty  = 0U;
+}
+
 dmod_dmgpio_port_api_declaration(1.0, int, _begin_configuration,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
 {
     if (!is_valid_port(port)) return -1;
     (void)pins;
+    uint32_t key = stm32_lock(port);
+    s_config_shadow[port].depth++;
+    stm32_unlock(port, key);
     return 0;
 }
 
@@ -148,6 +486,124 @@ dmod_dmgpio_port_api_declaration(1.0, int, _finish_configuration,
 {
     if (!is_valid_port(port)) return -1;
     (void)pins;
+    int      ret = 0;
+    uint32_t key = stm32_lock(port);
+    if (s_config_shadow[port].depth == 0U)
+        ret = -1;
+    else
+        cfg_end_session(port);
+    stm32_unlock(port, key);
+    return ret;
+}
+
+/**
+ * @brief Bits of the fields of @p pins in a configuration register.
+ */
+static uint32_t cfg_field_mask(stm32_cfg_reg_t reg, dmgpio_pins_mask_t pins)
+{
+    uint32_t mask = 0U;
+    for (uint32_t pin = 0; pin < 16U; pin++)
+    {
+        if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
+        switch (reg)
+        {
+            case STM32_CFG_OTYPER: mask |= 1U << pin;                                   break;
+            case STM32_CFG_AFRL:   if (pin < 8U)  mask |= 0xFU << (pin * 4U);           break;
+            case STM32_CFG_AFRH:   if (pin >= 8U) mask |= 0xFU << ((pin - 8U) * 4U);    break;
+            default:               mask |= 3U << (pin * 2U);                            break;
+        }
+    }
+    return mask;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _discard_configuration,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
+{
+    if (!is_valid_port(port)) return -1;
+    uint32_t masks[STM32_CFG_COUNT];
+    for (uint32_t reg = 0; reg < STM32_CFG_COUNT; reg++)
+        masks[reg] = cfg_field_mask((stm32_cfg_reg_t)reg, pins);
+
+    /* Nothing reaches the registers before the commit, so they still hold
+     * the fields of @p pins as they were when the session was opened. */
+    int      ret = 0;
+    uint32_t key = stm32_lock(port);
+    stm32_config_shadow_t *shadow = &s_config_shadow[port];
+    if (shadow->depth == 0U)
+        ret = -1;
+    else
+    {
+        for (uint32_t loaded = shadow->loaded; loaded != 0U; loaded &= loaded - 1U)
+        {
+            stm32_cfg_reg_t reg = (stm32_cfg_reg_t)__builtin_ctz(loaded);
+            shadow->value[reg] = (shadow->value[reg] & ~masks[reg]) | (*cfg_hw_reg(port, reg) & masks[reg]);
+        }
+    }
+    stm32_unlock(port, key);
+    return ret;
+}
+
+/**
+ * @brief Merge the fields of @p image into a configuration register.
+ */
+static void cfg_apply(dmgpio_port_t port, stm32_cfg_reg_t reg, const dmgpio_register_image_t *image)
+{
+    if (image->mask == 0U) return;
+    uint32_t val = cfg_read(port, reg);
+    cfg_write(port, reg, (val & ~image->mask) | (image->value & image->mask));
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _apply_image,
+    ( const dmgpio_port_image_t *image ))
+{
+    if (image == NULL || !is_valid_port(image->port)) return -1;
+    dmgpio_port_t port = image->port;
+
+    /* The image goes through a session of its own, so each register is
+     * read and written once and MODER is committed last. */
+    uint32_t key = stm32_lock(port);
+    s_config_shadow[port].depth++;
+    cfg_apply(port, STM32_CFG_OTYPER,  &image->otyper);
+    cfg_apply(port, STM32_CFG_OSPEEDR, &image->ospeedr);
+    cfg_apply(port, STM32_CFG_PUPDR,   &image->pupdr);
+    cfg_apply(port, STM32_CFG_AFRL,    &image->afr[0]);
+    cfg_apply(port, STM32_CFG_AFRH,    &image->afr[1]);
+    cfg_apply(port, STM32_CFG_MODER,   &image->moder);
+    cfg_end_session(port);
+    stm32_unlock(port, key);
+
+    uint32_t lines = (uint32_t)image->exti_rising | (uint32_t)image->exti_falling;
+    if (lines == 0U) return 0;
+
+    /* Same sequence as _set_interrupt_trigger, one access per register
+     * for all lines instead of one per pin. */
+    key = stm32_lock(STM32_LOCK_SHARED);
+    STM32_RCC_APB2ENR |= STM32_RCC_APB2ENR_SYSCFGEN;
+    (void)STM32_RCC_APB2ENR;
+    for (uint32_t i = 0; i < 4U; i++)
+    {
+        const dmgpio_register_image_t *cr = &image->exticr[i];
+        if (cr->mask != 0U)
+            STM32_SYSCFG_EXTICR[i] = (STM32_SYSCFG_EXTICR[i] & ~cr->mask) | (cr->value & cr->mask);
+    }
+
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    exti->RTSR = (exti->RTSR & ~lines) | (uint32_t)image->exti_rising;
+    exti->FTSR = (exti->FTSR & ~lines) | (uint32_t)image->exti_falling;
+    exti->IMR |= lines;
+    for (uint32_t l = lines; l != 0U; l &= l - 1U)
+        s_exti_line_port[__builtin_ctz(l)] = port;
+    stm32_unlock(STM32_LOCK_SHARED, key);
+
+    /* ISER is write-1-to-set and needs no section */
+    uint64_t irqs = 0U;     /* bit N = NVIC IRQ N already enabled (EXTI IRQs are below 64) */
+    for (uint32_t l = lines; l != 0U; l &= l - 1U)
+    {
+        uint32_t irqn = exti_pin_to_irqn(__builtin_ctz(l));
+        if (irqs & (1ULL << irqn)) continue;
+        irqs |= 1ULL << irqn;
+        nvic_enable_irq(irqn);
+    }
     return 0;
 }
 
@@ -155,23 +611,64 @@ dmod_dmgpio_port_api_declaration(1.0, int, _finish_configuration,
  *  Clock / power
  * ====================================================================== */
 
+/**
+ * @brief Return the core clock (HCLK) frequency, which is the rate of the
+ *        DWT cycle counter, from the current RCC settings.
+ *
+ * F4 and F7 share the RCC_CFGR/RCC_PLLCFGR layout.  The HSE frequency is
+ * not visible in any register and comes from STM32_HSE_HZ.
+ */
+static uint32_t core_clock_hz(void)
+{
+    static const uint8_t hpre_shift[8] = { 1U, 2U, 3U, 4U, 6U, 7U, 8U, 9U };
+    uint32_t cfgr = STM32_RCC_CFGR;
+    uint32_t sysclk;
+
+    switch ((cfgr >> 2U) & 3U)  /* SWS: clock in use */
+    {
+        case 0U: sysclk = STM32_HSI_HZ; break;
+        case 1U: sysclk = STM32_HSE_HZ; break;
+        default:
+        {
+            /* PLL: input / PLLM * PLLN / PLLP (SWS = 3 selects PLLR on F446) */
+            uint32_t pllcfgr = STM32_RCC_PLLCFGR;
+            uint32_t input   = (pllcfgr & (1U << 22U)) ? STM32_HSE_HZ : STM32_HSI_HZ;
+            uint32_t pllm    = pllcfgr & 0x3FU;
+            uint32_t plln    = (pllcfgr >> 6U) & 0x1FFU;
+            uint32_t div     = (((cfgr >> 2U) & 3U) == 3U) ? ((pllcfgr >> 28U) & 7U)
+                                                           : ((((pllcfgr >> 16U) & 3U) + 1U) * 2U);
+            if (pllm == 0U || div == 0U) return STM32_HSI_HZ;
+            sysclk = (uint32_t)((uint64_t)input * plln / pllm / div);
+            break;
+        }
+    }
+
+    uint32_t hpre = (cfgr >> 4U) & 0xFU;
+    return (hpre & 0x8U) ? (sysclk >> hpre_shift[hpre & 0x7U]) : sysclk;
+}
+
 dmod_dmgpio_port_api_declaration(1.0, int, _set_power,
     ( dmgpio_port_t port, int power_on ))
 {
     if (!is_valid_port(port)) return -1;
-    /*
-     * Note: read-modify-write on RCC_AHB1ENR is not atomic.
-     * This function should be called only from a single context during
-     * initialisation/deinitialisation to avoid race conditions.
-     */
-    if (power_on)
-        STM32_RCC_AHB1ENR |= (1U << (uint32_t)port);
-    else
-        STM32_RCC_AHB1ENR &= ~(1U << (uint32_t)port);
-    /* Read-back barrier: ensure the clock-enable write has completed before
-     * any subsequent GPIO register access (required on Cortex-M7 and some
-     * Renode models that enforce peripheral clock gating). */
-    (void)STM32_RCC_AHB1ENR;
+    /* RCC_AHB1ENR holds the clocks of every port (and of other peripherals) */
+    uint32_t key     = stm32_lock(STM32_LOCK_SHARED);
+    uint32_t ahb1enr = STM32_RCC_AHB1ENR;
+    uint32_t enabled = ahb1enr & (1U << (uint32_t)port);
+    /* Every device on a port powers it; only the first call changes anything. */
+    if ((enabled != 0U) != (power_on != 0))
+    {
+        if (power_on)
+            STM32_RCC_AHB1ENR = ahb1enr | (1U << (uint32_t)port);
+        else
+            STM32_RCC_AHB1ENR = ahb1enr & ~(1U << (uint32_t)port);
+        /* Read-back barrier: ensure the clock-enable write has completed
+         * before any subsequent GPIO register access (required on
+         * Cortex-M7 and some Renode models that enforce peripheral clock
+         * gating). */
+        (void)STM32_RCC_AHB1ENR;
+    }
+    stm32_unlock(STM32_LOCK_SHARED, key);
     return 0;
 }
 
@@ -236,7 +733,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_speed,
         case dmgpio_speed_maximum:  ospeedr_val = 3U; break;
         default:                    return -1;
     }
-    set_2bit_fields(&STM32_GPIO(port)->OSPEEDR, pins, ospeedr_val);
+    set_2bit_fields(port, STM32_CFG_OSPEEDR, pins, ospeedr_val);
     return 0;
 }
 
@@ -244,7 +741,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_speed,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_speed_t *out_speed ))
 {
     if (!is_valid_port(port) || out_speed == NULL || pins == 0U) return -1;
-    switch (read_2bit_field(&STM32_GPIO(port)->OSPEEDR, pins))
+    switch (read_2bit_field(port, STM32_CFG_OSPEEDR, pins))
     {
         case 0U: *out_speed = dmgpio_speed_minimum; break;
         case 1U: *out_speed = dmgpio_speed_medium;  break;
@@ -289,7 +786,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_mode,
         case dmgpio_mode_alternate: moder_val = 2U; break;
         default:                    return -1;
     }
-    set_2bit_fields(&STM32_GPIO(port)->MODER, pins, moder_val);
+    set_2bit_fields(port, STM32_CFG_MODER, pins, moder_val);
     return 0;
 }
 
@@ -297,7 +794,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_mode,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_mode_t *out_mode ))
 {
     if (!is_valid_port(port) || out_mode == NULL || pins == 0U) return -1;
-    switch (read_2bit_field(&STM32_GPIO(port)->MODER, pins))
+    switch (read_2bit_field(port, STM32_CFG_MODER, pins))
     {
         case 0U: *out_mode = dmgpio_mode_input;     break;
         case 1U: *out_mode = dmgpio_mode_output;    break;
@@ -319,7 +816,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_pull,
         case dmgpio_pull_down:    pupdr_val = 2U; break;
         default:                  return -1;
     }
-    set_2bit_fields(&STM32_GPIO(port)->PUPDR, pins, pupdr_val);
+    set_2bit_fields(port, STM32_CFG_PUPDR, pins, pupdr_val);
     return 0;
 }
 
@@ -327,7 +824,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_pull,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pull_t *out_pull ))
 {
     if (!is_valid_port(port) || out_pull == NULL || pins == 0U) return -1;
-    switch (read_2bit_field(&STM32_GPIO(port)->PUPDR, pins))
+    switch (read_2bit_field(port, STM32_CFG_PUPDR, pins))
     {
         case 1U: *out_pull = dmgpio_pull_up;      break;
         case 2U: *out_pull = dmgpio_pull_down;    break;
@@ -340,14 +837,23 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_output_circuit,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_output_circuit_t oc ))
 {
     if (!is_valid_port(port)) return -1;
-    volatile stm32_gpio_t *gpio = STM32_GPIO(port);
+    uint32_t open_drain;
     switch (oc)
     {
         case dmgpio_output_circuit_default:    return 0; /* leave hardware default */
-        case dmgpio_output_circuit_push_pull:  gpio->OTYPER &= ~(uint32_t)pins; break;
-        case dmgpio_output_circuit_open_drain: gpio->OTYPER |=  (uint32_t)pins; break;
+        case dmgpio_output_circuit_push_pull:  open_drain = 0U;              break;
+        case dmgpio_output_circuit_open_drain: open_drain = (uint32_t)pins; break;
         default:                               return -1;
     }
+    uint32_t key = stm32_lock(port);
+#if defined(STM32_BIT_BAND_ALIAS)
+    /* One pin outside a session: a single store, no OTYPER read */
+    if (pins != 0U && (pins & (pins - 1U)) == 0U && s_config_shadow[port].depth == 0U)
+        reg_write_bit(&STM32_GPIO(port)->OTYPER, (uint32_t)__builtin_ctz(pins), open_drain != 0U);
+    else
+#endif
+    cfg_write(port, STM32_CFG_OTYPER, (cfg_read(port, STM32_CFG_OTYPER) & ~(uint32_t)pins) | open_drain);
+    stm32_unlock(port, key);
     return 0;
 }
 
@@ -355,32 +861,38 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_output_circuit,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_output_circuit_t *out_oc ))
 {
     if (!is_valid_port(port) || out_oc == NULL || pins == 0U) return -1;
+    uint32_t key    = stm32_lock(port);
+    uint32_t otyper = cfg_read(port, STM32_CFG_OTYPER);
+    stm32_unlock(port, key);
     /* Read from the lowest set pin. */
-    for (int pin = 0; pin < 16; pin++)
-    {
-        if (pins & (dmgpio_pins_mask_t)(1U << pin))
-        {
-            *out_oc = (STM32_GPIO(port)->OTYPER & (1U << (uint32_t)pin))
-                ? dmgpio_output_circuit_open_drain
-                : dmgpio_output_circuit_push_pull;
-            return 0;
-        }
-    }
-    return -1;
+    *out_oc = (otyper & (1U << (uint32_t)__builtin_ctz(pins)))
+        ? dmgpio_output_circuit_open_drain
+        : dmgpio_output_circuit_push_pull;
+    return 0;
 }
 
 dmod_dmgpio_port_api_declaration(1.0, int, _set_alternate_function,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint8_t af ))
 {
     if (!is_valid_port(port) || af > 15U) return -1;
-    volatile stm32_gpio_t *gpio = STM32_GPIO(port);
-    for (int pin = 0; pin < 16; pin++)
+    /* AFR[0] covers pins 0-7, AFR[1] covers pins 8-15; 4 bits per pin */
+    for (uint32_t half = 0; half < 2U; half++)
     {
-        if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
-        /* AFR[0] covers pins 0-7, AFR[1] covers pins 8-15; 4 bits per pin */
-        uint32_t reg_idx = (uint32_t)pin / 8U;
-        uint32_t shift   = ((uint32_t)pin % 8U) * 4U;
-        gpio->AFR[reg_idx] = (gpio->AFR[reg_idx] & ~(0xFU << shift)) | ((uint32_t)af << shift);
+        uint32_t half_pins = ((uint32_t)pins >> (half * 8U)) & 0xFFU;
+        if (half_pins == 0U) continue;
+        stm32_cfg_reg_t reg = (half == 0U) ? STM32_CFG_AFRL : STM32_CFG_AFRH;
+        uint32_t mask = 0U;
+        uint32_t bits = 0U;
+        for (uint32_t pin = 0; pin < 8U; pin++)
+        {
+            if (!(half_pins & (1U << pin))) continue;
+            uint32_t shift = pin * 4U;
+            mask |= 0xFU << shift;
+            bits |= (uint32_t)af << shift;
+        }
+        uint32_t key = stm32_lock(port);
+        cfg_write(port, reg, (cfg_read(port, reg) & ~mask) | bits);
+        stm32_unlock(port, key);
     }
     return 0;
 }
@@ -390,17 +902,14 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_alternate_function,
 {
     if (!is_valid_port(port) || out_af == NULL || pins == 0U) return -1;
     /* Read from the lowest set pin. */
-    for (int pin = 0; pin < 16; pin++)
-    {
-        if (pins & (dmgpio_pins_mask_t)(1U << pin))
-        {
-            uint32_t reg_idx = (uint32_t)pin / 8U;
-            uint32_t shift   = ((uint32_t)pin % 8U) * 4U;
-            *out_af = (uint8_t)((STM32_GPIO(port)->AFR[reg_idx] >> shift) & 0xFU);
-            return 0;
-        }
-    }
-    return -1;
+    int             pin   = __builtin_ctz(pins);
+    stm32_cfg_reg_t reg   = (pin < 8) ? STM32_CFG_AFRL : STM32_CFG_AFRH;
+    uint32_t        shift = ((uint32_t)pin % 8U) * 4U;
+    uint32_t        key   = stm32_lock(port);
+    uint32_t        afr   = cfg_read(port, reg);
+    stm32_unlock(port, key);
+    *out_af = (uint8_t)((afr >> shift) & 0xFU);
+    return 0;
 }
 
 dmod_dmgpio_port_api_declaration(1.0, int, _set_interrupt_trigger,
@@ -417,14 +926,20 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_interrupt_trigger,
     {
         if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
 
-        uint32_t pin_mask = 1U << (uint32_t)pin;
-
+        /* EXTI and SYSCFG registers are shared by all ports */
+        uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+        /* A debounce window or throttling in progress ends here: IMR is
+         * set below. */
+        s_debounce_waiting &= ~(1U << (uint32_t)pin);
+        s_rate_throttled   &= ~(1U << (uint32_t)pin);
         if (trigger == dmgpio_int_trigger_off)
         {
-            exti->IMR  &= ~pin_mask;
-            exti->RTSR &= ~pin_mask;
-            exti->FTSR &= ~pin_mask;
+            reg_write_bit(&exti->IMR,  (uint32_t)pin, 0U);
+            reg_write_bit(&exti->RTSR, (uint32_t)pin, 0U);
+            reg_write_bit(&exti->FTSR, (uint32_t)pin, 0U);
             nvic_disable_irq(exti_pin_to_irqn(pin));
+            if (s_exti_line_port[pin] == port)
+                s_exti_line_port[pin] = STM32_EXTI_LINE_UNMAPPED;
         }
         else
         {
@@ -441,20 +956,14 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_interrupt_trigger,
             STM32_SYSCFG_EXTICR[exticr_idx] =
                 (STM32_SYSCFG_EXTICR[exticr_idx] & ~(0xFU << exticr_shift)) |
                 ((uint32_t)port << exticr_shift);
+            s_exti_line_port[pin] = port;
 
-            if (trigger & dmgpio_int_trigger_rising_edge)
-                exti->RTSR |= pin_mask;
-            else
-                exti->RTSR &= ~pin_mask;
-
-            if (trigger & dmgpio_int_trigger_falling_edge)
-                exti->FTSR |= pin_mask;
-            else
-                exti->FTSR &= ~pin_mask;
-
-            exti->IMR |= pin_mask;
+            reg_write_bit(&exti->RTSR, (uint32_t)pin, (trigger & dmgpio_int_trigger_rising_edge) ? 1U : 0U);
+            reg_write_bit(&exti->FTSR, (uint32_t)pin, (trigger & dmgpio_int_trigger_falling_edge) ? 1U : 0U);
+            reg_write_bit(&exti->IMR,  (uint32_t)pin, 1U);
             nvic_enable_irq(exti_pin_to_irqn(pin));
         }
+        stm32_unlock(STM32_LOCK_SHARED, key);
     }
     return 0;
 }
@@ -471,7 +980,9 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_interrupt_trigger,
         if (!(pins & (dmgpio_pins_mask_t)(1U << pin))) continue;
 
         uint32_t pin_mask = 1U << (uint32_t)pin;
-        if (!(exti->IMR & pin_mask))
+        uint32_t held     = __atomic_load_n(&s_debounce_waiting, __ATOMIC_RELAXED) |
+                            __atomic_load_n(&s_rate_throttled, __ATOMIC_RELAXED);
+        if (!(exti->IMR & pin_mask) && !(held & pin_mask))
         {
             *out_trigger = dmgpio_int_trigger_off;
         }
@@ -497,11 +1008,55 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_interrupt_trigger,
  *  Pin usage tracking
  * ====================================================================== */
 
+dmod_dmgpio_port_api_declaration(1.0, int, _claim_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ))
+{
+    if (!is_valid_port(port) || pins == 0U) return -1;
+
+    /* All or nothing: the mask only changes if none of the pins is taken */
+    dmgpio_pins_mask_t used = __atomic_load_n(&s_pins_used[port], __ATOMIC_RELAXED);
+    do
+    {
+        if ((used & pins) != 0U) return -1;
+    } while (!__atomic_compare_exchange_n(&s_pins_used[port], &used, (dmgpio_pins_mask_t)(used | pins),
+                true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    for (dmgpio_pins_mask_t p = pins; p != 0U; p &= (dmgpio_pins_mask_t)(p - 1U))
+        __atomic_store_n(&s_pin_owners[port][__builtin_ctz(p)], owner, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _release_pins,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, void *owner ))
+{
+    if (!is_valid_port(port)) return -1;
+
+    /* Only the pins still owned by @p owner are released */
+    dmgpio_pins_mask_t owned = 0U;
+    for (dmgpio_pins_mask_t p = pins; p != 0U; p &= (dmgpio_pins_mask_t)(p - 1U))
+    {
+        void *expected = owner;
+        if (__atomic_compare_exchange_n(&s_pin_owners[port][__builtin_ctz(p)], &expected, NULL,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            owned |= (dmgpio_pins_mask_t)(p & -p);
+    }
+    __atomic_fetch_and(&s_pins_used[port], (dmgpio_pins_mask_t)~owned, __ATOMIC_RELEASE);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_pin_owner,
+    ( dmgpio_port_t port, dmgpio_pin_t pin, void **out_owner ))
+{
+    if (!is_valid_port(port) || pin > 15U || out_owner == NULL) return -1;
+    *out_owner = __atomic_load_n(&s_pin_owners[port][pin], __ATOMIC_ACQUIRE);
+    return 0;
+}
+
 dmod_dmgpio_port_api_declaration(1.0, int, _set_pins_used,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
 {
     if (!is_valid_port(port)) return -1;
-    s_pins_used[port] |= pins;
+    __atomic_fetch_or(&s_pins_used[port], pins, __ATOMIC_RELEASE);
     return 0;
 }
 
@@ -509,7 +1064,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _set_pins_unused,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins ))
 {
     if (!is_valid_port(port)) return -1;
-    s_pins_used[port] &= ~pins;
+    __atomic_fetch_and(&s_pins_used[port], (dmgpio_pins_mask_t)~pins, __ATOMIC_RELEASE);
     return 0;
 }
 
@@ -517,7 +1072,7 @@ dmod_dmgpio_port_api_declaration(1.0, int, _check_is_pin_used,
     ( dmgpio_port_t port, dmgpio_pins_mask_t pins, int *out_used ))
 {
     if (!is_valid_port(port) || out_used == NULL) return -1;
-    *out_used = (s_pins_used[port] & pins) != 0U;
+    *out_used = (__atomic_load_n(&s_pins_used[port], __ATOMIC_ACQUIRE) & pins) != 0U;
     return 0;
 }
 
@@ -544,6 +1099,43 @@ dmod_dmgpio_port_api_declaration(1.0, int, _read_data,
     return 0;
 }
 
+/**
+ * Write one precomputed BSRR word per port.  The stores are issued
+ * back-to-back with interrupts masked, so the ports switch a few bus
+ * cycles apart and no ISR or task switch can land between them.
+ */
+dmod_dmgpio_port_api_declaration(1.0, int, _write_multi,
+    ( const dmgpio_port_t *ports, const uint32_t *set_reset, size_t count ))
+{
+    if (ports == NULL || set_reset == NULL) return -1;
+    for (size_t i = 0; i < count; i++)
+        if (!is_valid_port(ports[i])) return -1;
+
+    uint32_t primask = stm32_irq_save();
+    for (size_t i = 0; i < count; i++)
+        STM32_GPIO(ports[i])->BSRR = set_reset[i];
+    stm32_irq_restore(primask);
+    return 0;
+}
+
+/**
+ * Sample the IDR of several ports with interrupts masked, so the values
+ * are as close in time as the bus allows.
+ */
+dmod_dmgpio_port_api_declaration(1.0, int, _read_multi,
+    ( const dmgpio_port_t *ports, dmgpio_pins_mask_t *out_data, size_t count ))
+{
+    if (ports == NULL || out_data == NULL) return -1;
+    for (size_t i = 0; i < count; i++)
+        if (!is_valid_port(ports[i])) return -1;
+
+    uint32_t primask = stm32_irq_save();
+    for (size_t i = 0; i < count; i++)
+        out_data[i] = (dmgpio_pins_mask_t)STM32_GPIO(ports[i])->IDR;
+    stm32_irq_restore(primask);
+    return 0;
+}
+
 /* ======================================================================
  *  Pin state operations (no argument checking – caller must validate)
  * ====================================================================== */
@@ -577,9 +1169,490 @@ dmod_dmgpio_port_api_declaration(1.0, void, _toggle_pins_state,
 {
     if (!is_valid_port(port)) return;
     volatile stm32_gpio_t *gpio = STM32_GPIO(port);
+    /* ODR must not change between the read and the BSRR write, or a
+     * concurrent toggle of the same pins would be undone.  BSRR still only
+     * touches @p pins, so plain set/reset writes of other pins are kept. */
+    uint32_t key          = stm32_lock(port);
     uint32_t current_high = gpio->ODR & (uint32_t)pins;
     /* Set pins that are currently low, reset pins that are currently high. */
     gpio->BSRR = ((uint32_t)pins & ~current_high) | (current_high << 16U);
+    stm32_unlock(port, key);
+}
+
+/* ======================================================================
+ *  Direct register access
+ * ====================================================================== */
+
+dmod_dmgpio_port_api_declaration(1.0, int, _get_direct_access,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_direct_access_t *out_access ))
+{
+    if (!is_valid_port(port) || out_access == NULL) return -1;
+    volatile stm32_gpio_t *gpio = STM32_GPIO(port);
+    out_access->set_reset  = &gpio->BSRR;
+    out_access->input      = &gpio->IDR;
+    out_access->output     = &gpio->ODR;
+    out_access->set_word   = (uint32_t)pins;          /* BSRR lower half: set */
+    out_access->reset_word = (uint32_t)pins << 16U;   /* BSRR upper half: reset */
+    out_access->pins       = pins;
+#if defined(STM32_BIT_BAND_ALIAS)
+    out_access->input_bit  = (pins != 0U && (pins & (pins - 1U)) == 0U)
+        ? STM32_BIT_BAND_ALIAS(&gpio->IDR, __builtin_ctz(pins)) : NULL;
+#else
+    out_access->input_bit  = NULL;
+#endif
+    return 0;
+}
+
+/* ======================================================================
+ *  Interrupt dispatch
+ * ====================================================================== */
+
+/**
+ * @brief Call every handler of @p port that registered one of @p pins.
+ *
+ * Runs in the EXTI ISR for immediate dispatch and in the worker context
+ * for deferred dispatch.
+ */
+static void dispatch_port_event(dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    for (const stm32_port_irq_entry_t *entry = __atomic_load_n(&s_port_handlers[port], __ATOMIC_ACQUIRE);
+         entry != NULL;
+         entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE))
+    {
+        dmgpio_pins_mask_t match = entry->pins & pins;
+        if (match)
+            entry->handler(entry->user_ptr, port, match, state);
+    }
+}
+
+/**
+ * @brief Record an event in the deferred ring (ISR side).
+ *
+ * The ring has a single consumer and, as long as every EXTI IRQ has the
+ * same NVIC priority, a single producer.  The slot reservation is still
+ * done with interrupts masked so that EXTI ISRs configured at different
+ * priorities cannot interleave; that is a handful of instructions and
+ * the consumer never masks anything.  A full ring drops the new event
+ * and counts it in s_deferred_overflows.
+ */
+static void deferred_push(uint32_t timestamp, dmgpio_port_t port,
+                          dmgpio_pins_mask_t pins, dmgpio_pins_mask_t state)
+{
+    uint32_t primask = stm32_irq_save();
+    uint32_t head    = s_deferred_head;
+    if (head - __atomic_load_n(&s_deferred_tail, __ATOMIC_ACQUIRE) >= STM32_DEFERRED_RING_SIZE)
+    {
+        s_deferred_overflows++;
+    }
+    else
+    {
+        stm32_exti_event_t *event = &s_deferred_ring[head & (STM32_DEFERRED_RING_SIZE - 1U)];
+        event->timestamp = timestamp;
+        event->port      = port;
+        event->pins      = pins;
+        event->state     = state;
+        __atomic_store_n(&s_deferred_head, head + 1U, __ATOMIC_RELEASE);
+    }
+    stm32_irq_restore(primask);
+}
+
+/**
+ * @brief Mask debounced lines that just fired (ISR side).
+ *
+ * The first edge of a burst opens the window: the line stays masked in
+ * IMR, so the rest of the bounce raises no interrupt at all, until
+ * debounce_settle() finds the window expired.  A line with a one-edge
+ * trigger is never told when it returns, so the level it had before the
+ * edge is taken from the edge itself.
+ */
+static void debounce_start(uint32_t lines, uint32_t timestamp)
+{
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    for (; lines != 0U; lines &= lines - 1U)
+    {
+        uint32_t line    = (uint32_t)__builtin_ctz(lines);
+        uint32_t bit     = 1U << line;
+        uint32_t falling = exti->FTSR & bit;
+        if ((exti->RTSR & bit) != falling)
+        {
+            s_debounce_level  = (s_debounce_level & ~bit) | falling;
+            s_debounce_known |= bit;
+        }
+        reg_write_bit(&exti->IMR, line, 0U);
+        s_debounce_deadline[line] = timestamp + s_debounce_cycles[line];
+        s_debounce_waiting |= 1U << line;
+    }
+    stm32_unlock(STM32_LOCK_SHARED, key);
+}
+
+/**
+ * @brief Sample the debounced lines whose window has expired and dispatch
+ *        one event for each settled change that matches its trigger
+ *        (worker side).
+ *
+ * The line is unmasked before it is sampled, so an edge after the sample
+ * opens a new window instead of being lost.  The event carries the
+ * timestamp of the first edge of the burst.
+ *
+ * @return Number of events dispatched.
+ */
+static uint32_t debounce_settle(void)
+{
+    uint32_t waiting = __atomic_load_n(&s_debounce_waiting, __ATOMIC_ACQUIRE);
+    if (waiting == 0U) return 0U;
+
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    uint32_t now        = stm32_timestamp();
+    uint32_t dispatched = 0U;
+    for (; waiting != 0U; waiting &= waiting - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(waiting);
+        uint32_t bit  = 1U << line;
+        if ((int32_t)(now - s_debounce_deadline[line]) < 0) continue;
+
+        uint32_t key  = stm32_lock(STM32_LOCK_SHARED);
+        uint32_t port = s_exti_line_port[line];
+        if (!(s_debounce_waiting & bit) || port >= STM32_MAX_PORTS)
+        {
+            /* Reconfigured meanwhile: _set_interrupt_trigger owns IMR now */
+            stm32_unlock(STM32_LOCK_SHARED, key);
+            continue;
+        }
+        s_debounce_waiting &= ~bit;
+        exti->PR = bit;
+        reg_write_bit(&exti->IMR, line, 1U);
+        uint32_t level   = STM32_GPIO(port)->IDR & bit;
+        uint32_t changed = ((level ^ s_debounce_level) | ~s_debounce_known) & bit;
+        s_debounce_level  = (s_debounce_level & ~bit) | level;
+        s_debounce_known |= bit;
+        uint32_t trigger = level ? exti->RTSR : exti->FTSR;
+        uint32_t started = s_debounce_deadline[line] - s_debounce_cycles[line];
+        stm32_unlock(STM32_LOCK_SHARED, key);
+
+        if (changed && (trigger & bit))
+        {
+            s_event_timestamp = started;
+            dispatch_port_event((dmgpio_port_t)port, (dmgpio_pins_mask_t)bit, (dmgpio_pins_mask_t)level);
+            dispatched++;
+        }
+    }
+    return dispatched;
+}
+
+/**
+ * @brief Count the interrupts of rate-limited lines and throttle the lines
+ *        over budget (ISR side).
+ *
+ * A throttled line is masked in IMR, so it cannot keep the CPU in the ISR;
+ * rate_limit_poll() samples it once per window meanwhile and unmasks it
+ * after its backoff.  A line throttled again within a window of being
+ * unmasked stays masked twice as long, up to STM32_RATE_MAX_BACKOFF.
+ *
+ * @return Lines of @p lines that were throttled and must not be dispatched.
+ */
+static uint32_t rate_limit_account(uint32_t lines, uint32_t timestamp)
+{
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    uint32_t throttled = 0U;
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    for (; lines != 0U; lines &= lines - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(lines);
+        uint32_t bit  = 1U << line;
+        stm32_rate_limit_t *rate = &s_rate[line];
+        if (timestamp - rate->window_start >= s_rate_window_cycles)
+        {
+            rate->window_start = timestamp;
+            rate->count        = 0U;
+            s_rate_rearmed    &= ~bit;
+        }
+        if (++rate->count <= rate->budget) continue;
+
+        uint32_t port = s_exti_line_port[line];
+        reg_write_bit(&exti->IMR, line, 0U);
+        rate->backoff = (s_rate_rearmed & bit)
+            ? ((rate->backoff * 2U > STM32_RATE_MAX_BACKOFF) ? STM32_RATE_MAX_BACKOFF : rate->backoff * 2U)
+            : 1U;
+        rate->masked_at = timestamp;
+        rate->polled_at = timestamp;
+        rate->storms++;
+        s_rate_rearmed   &= ~bit;
+        s_rate_throttled |= bit;
+        if (port < STM32_MAX_PORTS)
+            s_rate_level = (s_rate_level & ~bit) | (STM32_GPIO(port)->IDR & bit);
+        throttled |= bit;
+    }
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    return throttled;
+}
+
+/**
+ * @brief Unmask a throttled line whose backoff has expired, calm or not: a
+ *        line still over budget is throttled again at once, for twice as
+ *        long.  Called with the shared lock held.
+ */
+static void rate_limit_rearm(uint32_t line, uint32_t now)
+{
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    uint32_t bit = 1U << line;
+    s_rate_throttled &= ~bit;
+    s_rate_rearmed   |= bit;
+    s_rate[line].window_start = now;
+    s_rate[line].count        = 0U;
+    exti->PR = bit;
+    reg_write_bit(&exti->IMR, line, 1U);
+}
+
+/**
+ * @brief Poll the throttled lines once per window, dispatching a change of
+ *        level that matches the trigger, and unmask the lines whose
+ *        backoff has expired (worker side).
+ *
+ * An event is dispatched while its line is still masked, so the ISR cannot
+ * run the same handlers meanwhile; the line is unmasked afterwards only if
+ * its level has not changed again since the sample, otherwise the next
+ * poll reports that change first.
+ *
+ * @return Number of events dispatched.
+ */
+static uint32_t rate_limit_poll(void)
+{
+    uint32_t throttled = __atomic_load_n(&s_rate_throttled, __ATOMIC_ACQUIRE);
+    if (throttled == 0U) return 0U;
+
+    volatile stm32_exti_t *exti = STM32_EXTI;
+    uint32_t now        = stm32_timestamp();
+    uint32_t dispatched = 0U;
+    for (; throttled != 0U; throttled &= throttled - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(throttled);
+        uint32_t bit  = 1U << line;
+        stm32_rate_limit_t *rate = &s_rate[line];
+        if (now - rate->polled_at < s_rate_window_cycles) continue;
+
+        uint32_t key  = stm32_lock(STM32_LOCK_SHARED);
+        uint32_t port = s_exti_line_port[line];
+        if (!(s_rate_throttled & bit) || port >= STM32_MAX_PORTS)
+        {
+            /* Reconfigured meanwhile: _set_interrupt_trigger owns IMR now */
+            stm32_unlock(STM32_LOCK_SHARED, key);
+            continue;
+        }
+        rate->polled_at  = now;
+        uint32_t level   = STM32_GPIO(port)->IDR & bit;
+        uint32_t changed = (level ^ s_rate_level) & bit;
+        s_rate_level    ^= changed;
+        uint32_t event   = changed & (level ? exti->RTSR : exti->FTSR);
+        int      expired = (now - rate->masked_at >= rate->backoff * s_rate_window_cycles);
+        if (event)
+            rate->polled_events++;
+        else if (expired)
+            rate_limit_rearm(line, now);
+        stm32_unlock(STM32_LOCK_SHARED, key);
+        if (!event) continue;
+
+        s_event_timestamp = now;
+        dispatch_port_event((dmgpio_port_t)port, (dmgpio_pins_mask_t)bit, (dmgpio_pins_mask_t)level);
+        dispatched++;
+        if (!expired) continue;
+
+        key = stm32_lock(STM32_LOCK_SHARED);
+        if ((s_rate_throttled & bit) && s_exti_line_port[line] == port &&
+            ((STM32_GPIO(port)->IDR ^ s_rate_level) & bit) == 0U)
+            rate_limit_rearm(line, now);
+        stm32_unlock(STM32_LOCK_SHARED, key);
+    }
+    return dispatched;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_deferred_dispatch,
+    ( dmgpio_port_t port, int deferred ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (deferred)
+    {
+        stm32_timestamp_enable();
+        __atomic_fetch_or(&s_deferred_ports, 1U << port, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        /* Events already in the ring are still delivered by the worker. */
+        __atomic_fetch_and(&s_deferred_ports, ~(1U << port), __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_debounce,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t debounce_us ))
+{
+    if (!is_valid_port(port)) return -1;
+    uint64_t cycles = (uint64_t)debounce_us * core_clock_hz() / 1000000U;
+    /* Deadlines are compared as signed differences of the wrapping counter */
+    if (cycles > 0x7FFFFFFFU) return -1;
+    if (cycles != 0U)
+        stm32_timestamp_enable();
+
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    for (uint32_t lines = pins; lines != 0U; lines &= lines - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(lines);
+        s_debounce_cycles[line] = (uint32_t)cycles;
+    }
+    if (cycles != 0U)
+        s_debounce_lines |= (uint32_t)pins;
+    else
+        s_debounce_lines &= ~(uint32_t)pins;
+    s_debounce_known &= ~(uint32_t)pins;
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _set_rate_limit,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, uint32_t max_per_second ))
+{
+    if (!is_valid_port(port)) return -1;
+    if (max_per_second != 0U)
+        stm32_timestamp_enable();
+
+    /* Rounded up, so a limit never allows fewer interrupts than asked for */
+    uint32_t budget = (uint32_t)(((uint64_t)max_per_second + STM32_RATE_WINDOWS_PER_SECOND - 1U) /
+                                 STM32_RATE_WINDOWS_PER_SECOND);
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    s_rate_window_cycles = core_clock_hz() / STM32_RATE_WINDOWS_PER_SECOND;
+    for (uint32_t lines = pins; lines != 0U; lines &= lines - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(lines);
+        s_rate[line].budget       = budget;
+        s_rate[line].count        = 0U;
+        s_rate[line].window_start = stm32_timestamp();
+    }
+    if (budget != 0U)
+        s_rate_lines |= (uint32_t)pins;
+    else
+        s_rate_lines &= ~(uint32_t)pins;
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_rate_limit_stats,
+    ( dmgpio_port_t port, dmgpio_pins_mask_t pins, dmgpio_rate_limit_stats_t *out_stats ))
+{
+    if (!is_valid_port(port) || out_stats == NULL) return -1;
+    out_stats->storms        = 0U;
+    out_stats->polled_events = 0U;
+    out_stats->throttled     = 0U;
+
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    for (uint32_t lines = pins; lines != 0U; lines &= lines - 1U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(lines);
+        if (s_exti_line_port[line] != port) continue;
+        out_stats->storms        += s_rate[line].storms;
+        out_stats->polled_events += s_rate[line].polled_events;
+    }
+    out_stats->throttled = (dmgpio_pins_mask_t)(s_rate_throttled & (uint32_t)pins);
+    stm32_unlock(STM32_LOCK_SHARED, key);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _process_deferred_interrupts,
+    ( uint32_t max_events ))
+{
+    /* The slot is copied out before the tail is released back to the ISR,
+     * so a handler may run for as long as it likes without the ISR ever
+     * overwriting the event it is processing. */
+    uint32_t tail      = s_deferred_tail;
+    uint32_t processed = debounce_settle() + rate_limit_poll();
+    while (max_events == 0U || processed < max_events)
+    {
+        if (tail == __atomic_load_n(&s_deferred_head, __ATOMIC_ACQUIRE)) break;
+        stm32_exti_event_t event = s_deferred_ring[tail & (STM32_DEFERRED_RING_SIZE - 1U)];
+        tail++;
+        __atomic_store_n(&s_deferred_tail, tail, __ATOMIC_RELEASE);
+
+        s_event_timestamp = event.timestamp;
+        dispatch_port_event(event.port, event.pins, event.state);
+        processed++;
+    }
+    return (int)processed;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_deferred_overflows,
+    ( uint32_t *out_count ))
+{
+    if (out_count == NULL) return -1;
+    *out_count = __atomic_load_n(&s_deferred_overflows, __ATOMIC_RELAXED);
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_event_timestamp,
+    ( uint32_t *out_timestamp ))
+{
+    if (out_timestamp == NULL) return -1;
+    *out_timestamp = s_event_timestamp;
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_cycle_counter,
+    ( uint32_t *out_count ))
+{
+    if (out_count == NULL) return -1;
+    *out_count = stm32_timestamp();
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_cycle_counter_rate,
+    ( uint32_t *out_hz ))
+{
+    if (out_hz == NULL) return -1;
+    *out_hz = core_clock_hz();
+    return 0;
+}
+
+dmod_dmgpio_port_api_declaration(1.0, int, _read_diagnostics,
+    ( dmgpio_diagnostics_t *out_diag ))
+{
+    if (out_diag == NULL) return -1;
+
+    /* Copy the pin and EXTI state in one section: on target interrupts are
+     * masked, so no ISR can count a line half-way. */
+    uint32_t key = stm32_lock(STM32_LOCK_SHARED);
+    for (uint32_t port = 0; port < DMGPIO_DIAG_PORTS; port++)
+        out_diag->pins_used[port] = (port < STM32_MAX_PORTS) ? s_pins_used[port] : 0U;
+    for (uint32_t i = 0; i < 4U; i++)
+        out_diag->exticr[i] = STM32_SYSCFG_EXTICR[i];
+    out_diag->exti_imr  = STM32_EXTI->IMR;
+    out_diag->exti_rtsr = STM32_EXTI->RTSR;
+    out_diag->exti_ftsr = STM32_EXTI->FTSR;
+    for (uint32_t line = 0; line < 16U; line++)
+        out_diag->line_interrupts[line] = s_exti_line_interrupts[line];
+    stm32_unlock(STM32_LOCK_SHARED, key);
+
+    /* Each handler list is copied under the lock of its port, the one
+     * _add/_remove_interrupt_handler take, and the walk stops once the
+     * snapshot is full, so a long list never holds the lock for more than
+     * DMGPIO_DIAG_HANDLERS entries.  The length comes from the count kept
+     * with the list. */
+    uint32_t count = 0U;
+    for (uint32_t port = 0; port < STM32_MAX_PORTS; port++)
+    {
+        key = stm32_lock(port);
+        const stm32_port_irq_entry_t *entry = s_port_handlers[port];
+        for (uint32_t listed = count; entry != NULL && listed < DMGPIO_DIAG_HANDLERS; listed++)
+        {
+            dmgpio_diag_handler_t *h = &out_diag->handlers[listed];
+            h->owner   = entry->user_ptr;
+            h->handler = entry->handler;
+            h->port    = (dmgpio_port_t)port;
+            h->pins    = entry->pins;
+            entry      = entry->next;
+        }
+        count += s_port_handler_count[port];
+        stm32_unlock(port, key);
+    }
+    out_diag->handler_count = count;
+    return 0;
 }
 
 /* ======================================================================
@@ -588,41 +1661,65 @@ dmod_dmgpio_port_api_declaration(1.0, void, _toggle_pins_state,
 
 void stm32_gpio_exti_irq_handler(uint32_t exti_lines)
 {
+    uint32_t timestamp = stm32_timestamp();
     volatile stm32_exti_t *exti = STM32_EXTI;
     uint32_t pending = exti->PR & exti_lines;
 
     if (pending == 0U) return;
 
-    /* Map each pending EXTI line to its owning GPIO port and accumulate masks. */
-    dmgpio_pins_mask_t port_pending[STM32_MAX_PORTS] = {0};
-    for (int pin = 0; pin < 16; pin++)
+    for (uint32_t lines = pending; lines != 0U; lines &= lines - 1U)
+        s_exti_line_interrupts[__builtin_ctz(lines)]++;
+
+    /* Debounced lines only open their window here; the event is sent by
+     * debounce_settle() once the input has settled. */
+    uint32_t held = pending & s_debounce_lines;
+    if (held != 0U)
+        debounce_start(held, timestamp);
+
+    /* Lines over their interrupt budget are masked and left to polling. */
+    uint32_t limited = pending & s_rate_lines & ~held;
+    if (limited != 0U)
+        held |= rate_limit_account(limited, timestamp);
+
+    /* Map each pending EXTI line to its owning GPIO port using the software
+     * copy of EXTICR.  Count-trailing-zeros iteration visits only the lines
+     * that are actually pending. */
+    dmgpio_pins_mask_t port_pending[STM32_MAX_PORTS];
+    uint32_t touched_ports = 0U;
+    for (uint32_t lines = pending & ~held; lines != 0U; lines &= lines - 1U)
     {
-        if (!(pending & (1U << (uint32_t)pin))) continue;
-        uint32_t exticr_idx   = (uint32_t)pin / 4U;
-        uint32_t exticr_shift = ((uint32_t)pin % 4U) * 4U;
-        dmgpio_port_t port    = (dmgpio_port_t)
-            ((STM32_SYSCFG_EXTICR[exticr_idx] >> exticr_shift) & 0xFU);
-        /* Guard against a corrupt/uninitialized EXTICR value that exceeds the
-         * number of supported ports (A–K = 0–10).  Writing beyond the array
-         * boundary would corrupt the ISR stack and crash other modules. */
-        if ((uint32_t)port >= STM32_MAX_PORTS) continue;
-        port_pending[port] |= (dmgpio_pins_mask_t)(1U << pin);
+        uint32_t line = (uint32_t)__builtin_ctz(lines);
+        uint32_t port = s_exti_line_port[line];
+        /* Lines routed outside dmgpio (or not at all) are only acknowledged. */
+        if (port >= STM32_MAX_PORTS) continue;
+        if (!(touched_ports & (1U << port)))
+        {
+            touched_ports |= 1U << port;
+            port_pending[port] = 0U;
+        }
+        port_pending[port] |= (dmgpio_pins_mask_t)(1U << line);
     }
 
-    /* Dispatch: one pass per port, one pass per handler — no per-pin inner loop. */
-    for (dmgpio_port_t port = 0; port < STM32_MAX_PORTS; port++)
+    /* One pass per touched port: either queue the event for the worker or
+     * run the registered handlers right here. */
+    for (; touched_ports != 0U; touched_ports &= touched_ports - 1U)
     {
-        if (port_pending[port] == 0U) continue;
+        dmgpio_port_t port = (dmgpio_port_t)__builtin_ctz(touched_ports);
         dmgpio_pins_mask_t state = (dmgpio_pins_mask_t)(STM32_GPIO(port)->IDR & (uint32_t)port_pending[port]);
-        for (uint8_t i = 0; i < STM32_PORT_MAX_IRQ_HANDLERS; i++)
+        if (s_deferred_ports & (1U << port))
         {
-            dmgpio_pins_mask_t match = s_port_handlers[port][i].pins & port_pending[port];
-            if (s_port_handlers[port][i].handler != NULL && match)
-                s_port_handlers[port][i].handler(s_port_handlers[port][i].user_ptr,
-                                                 port, match, state);
+            deferred_push(timestamp, port, port_pending[port], state);
+        }
+        else
+        {
+            /* Save and restore so that a worker preempted inside a deferred
+             * handler still reads its own event's timestamp afterwards. */
+            uint32_t saved_timestamp = s_event_timestamp;
+            s_event_timestamp = timestamp;
+            dispatch_port_event(port, port_pending[port], state);
+            s_event_timestamp = saved_timestamp;
         }
     }
 
     exti->PR = pending; /* Writing 1 clears the pending bit. */
 }
-
@@ -34,6 +34,48 @@ typedef struct
     volatile uint32_t PR;     /**< Pending register */
 } stm32_exti_t;
 
+/** Maximum number of GPIO ports supported (A=0 … K=10) */
+#define STM32_MAX_PORTS         11U
+
+#if defined(STM32_HOST_SIMULATION)
+
+/*
+ * Host simulation: the register blocks live in ordinary memory owned by the
+ * host port (src/port/host).  The common code is compiled unchanged against
+ * these definitions, so every access it performs on target is performed on
+ * the simulated registers instead.
+ */
+extern stm32_gpio_t      stm32_host_gpio[STM32_MAX_PORTS];
+extern stm32_exti_t      stm32_host_exti;
+extern volatile uint32_t stm32_host_rcc_pllcfgr;
+extern volatile uint32_t stm32_host_rcc_cfgr;
+extern volatile uint32_t stm32_host_rcc_ahb1enr;
+extern volatile uint32_t stm32_host_rcc_apb2enr;
+extern volatile uint32_t stm32_host_syscfg_exticr[4];
+extern volatile uint32_t stm32_host_nvic_iser[8];
+extern volatile uint32_t stm32_host_nvic_icer[8];
+extern volatile uint32_t stm32_host_demcr;
+extern volatile uint32_t stm32_host_dwt_ctrl;
+extern volatile uint32_t stm32_host_dwt_cyccnt;
+extern volatile uint32_t stm32_host_dwt_lar;
+extern uint8_t           stm32_host_locks[STM32_MAX_PORTS + 1U];
+
+#define STM32_GPIO(port)        (&stm32_host_gpio[(port)])
+#define STM32_RCC_PLLCFGR       stm32_host_rcc_pllcfgr
+#define STM32_RCC_CFGR          stm32_host_rcc_cfgr
+#define STM32_RCC_AHB1ENR       stm32_host_rcc_ahb1enr
+#define STM32_RCC_APB2ENR       stm32_host_rcc_apb2enr
+#define STM32_SYSCFG_EXTICR     (stm32_host_syscfg_exticr)
+#define STM32_EXTI              (&stm32_host_exti)
+#define STM32_NVIC_ISER         (stm32_host_nvic_iser)
+#define STM32_NVIC_ICER         (stm32_host_nvic_icer)
+#define STM32_DEMCR             stm32_host_demcr
+#define STM32_DWT_CTRL          stm32_host_dwt_ctrl
+#define STM32_DWT_CYCCNT        stm32_host_dwt_cyccnt
+#define STM32_DWT_LAR           stm32_host_dwt_lar
+
+#else
+
 /** GPIO port A base address */
 #define STM32_GPIOA_BASE        0x40020000UL
 /** Size of each GPIO port register block */
@@ -41,12 +83,14 @@ typedef struct
 /** Pointer to the GPIO register block for a given port index (0=A, 1=B, ...) */
 #define STM32_GPIO(port)        ((stm32_gpio_t *)(STM32_GPIOA_BASE + (uint32_t)(port) * STM32_GPIO_PORT_SIZE))
 
+/** RCC PLL configuration register */
+#define STM32_RCC_PLLCFGR       (*(volatile uint32_t *)0x40023804UL)
+/** RCC clock configuration register */
+#define STM32_RCC_CFGR          (*(volatile uint32_t *)0x40023808UL)
 /** RCC AHB1 peripheral clock enable register */
 #define STM32_RCC_AHB1ENR       (*(volatile uint32_t *)0x40023830UL)
 /** RCC APB2 peripheral clock enable register */
 #define STM32_RCC_APB2ENR       (*(volatile uint32_t *)0x40023844UL)
-/** Bit in RCC_APB2ENR that enables the SYSCFG peripheral clock */
-#define STM32_RCC_APB2ENR_SYSCFGEN  (1U << 14U)
 /** SYSCFG external interrupt configuration registers (EXTICR1-4) */
 #define STM32_SYSCFG_EXTICR     ((volatile uint32_t *)0x40013808UL)
 /** EXTI controller base */
@@ -57,8 +101,142 @@ typedef struct
 /** NVIC Interrupt Clear-Enable Registers */
 #define STM32_NVIC_ICER         ((volatile uint32_t *)0xE000E180UL)
 
-/** Maximum number of GPIO ports supported (A=0 … K=10) */
-#define STM32_MAX_PORTS         11U
+/** Debug Exception and Monitor Control Register (TRCENA gates the DWT) */
+#define STM32_DEMCR             (*(volatile uint32_t *)0xE000EDFCUL)
+/** DWT control register */
+#define STM32_DWT_CTRL          (*(volatile uint32_t *)0xE0001000UL)
+/** DWT cycle counter */
+#define STM32_DWT_CYCCNT        (*(volatile uint32_t *)0xE0001004UL)
+/** DWT lock access register (Cortex-M7 only; writes are ignored on Cortex-M4) */
+#define STM32_DWT_LAR           (*(volatile uint32_t *)0xE0001FB0UL)
+
+#endif /* STM32_HOST_SIMULATION */
+
+#if defined(STM32_BIT_BAND) && !defined(STM32_HOST_SIMULATION)
+/** Peripheral region mapped by the bit-band alias (Cortex-M3/M4 only) */
+#define STM32_PERIPH_BASE       0x40000000UL
+/** Bit-band alias of the peripheral region: one word per register bit */
+#define STM32_PERIPH_BB_BASE    0x42000000UL
+/** Alias word of bit @p bit of the peripheral register at @p reg; a store
+ *  sets or clears just that bit in one bus write, a load reads it as 0/1 */
+#define STM32_BIT_BAND_ALIAS(reg, bit) \
+    ((volatile uint32_t *)(STM32_PERIPH_BB_BASE + \
+        ((uint32_t)(uintptr_t)(reg) - STM32_PERIPH_BASE) * 32U + (uint32_t)(bit) * 4U))
+#endif
+
+/** Frequency of the internal HSI oscillator (F4 and F7) */
+#define STM32_HSI_HZ                16000000UL
+/** Frequency of the external HSE clock; boards with another crystal
+ *  override it in DMGPIO_PORT_DEFINITIONS */
+#ifndef STM32_HSE_HZ
+#define STM32_HSE_HZ                8000000UL
+#endif
+
+/** Bit in RCC_APB2ENR that enables the SYSCFG peripheral clock */
+#define STM32_RCC_APB2ENR_SYSCFGEN  (1U << 14U)
+/** Bit in DEMCR that enables the DWT and ITM blocks */
+#define STM32_DEMCR_TRCENA          (1U << 24U)
+/** Bit in DWT_CTRL that starts the cycle counter */
+#define STM32_DWT_CTRL_CYCCNTENA    (1U << 0U)
+/** Key that unlocks the DWT registers through DWT_LAR */
+#define STM32_DWT_LAR_KEY           0xC5ACCE55UL
+
+/**
+ * @brief Disable interrupts and return the previous PRIMASK value.
+ *
+ * Used for the few short sections that must not be interleaved with the
+ * EXTI ISR (e.g. updating the interrupt dispatch tables).
+ */
+static inline uint32_t stm32_irq_save(void)
+{
+#if defined(STM32_HOST_SIMULATION)
+    return 0U;  /* edges are injected synchronously on the host */
+#else
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) : : "memory");
+    return primask;
+#endif
+}
+
+/**
+ * @brief Restore the PRIMASK value returned by stm32_irq_save().
+ */
+static inline void stm32_irq_restore(uint32_t primask)
+{
+#if defined(STM32_HOST_SIMULATION)
+    (void)primask;
+#else
+    __asm volatile ("msr primask, %0" : : "r" (primask) : "memory");
+#endif
+}
+
+/** Lock of the registers shared by all ports (RCC, SYSCFG_EXTICR, EXTI) */
+#define STM32_LOCK_SHARED           STM32_MAX_PORTS
+
+/**
+ * @brief Enter the critical section of one port's registers (@p lock = port
+ *        index) or of the shared registers (STM32_LOCK_SHARED).
+ *
+ * Every read-modify-write of a register that another task or an ISR may
+ * also modify runs inside one of these sections; plain stores to BSRR need
+ * none.  On target it masks interrupts for the few cycles of the update:
+ * the core is single, so that excludes ISRs and every other task (a task
+ * switch is an interrupt) and an ISR can never spin on a lock held by the
+ * task it interrupted.  LDREX/STREX would not do: a STREX only fails after
+ * another exclusive access or an exception, not after a plain store to the
+ * same register.  On the host simulation, where tasks are real threads,
+ * it is one spinlock per index, so ports never wait on each other.
+ *
+ * @return Value to pass to stm32_unlock().
+ */
+static inline uint32_t stm32_lock(uint32_t lock)
+{
+#if defined(STM32_HOST_SIMULATION)
+    while (__atomic_test_and_set(&stm32_host_locks[lock], __ATOMIC_ACQUIRE))
+    {
+    }
+    return 0U;
+#else
+    (void)lock;
+    return stm32_irq_save();
+#endif
+}
+
+/**
+ * @brief Leave a section entered with stm32_lock().
+ */
+static inline void stm32_unlock(uint32_t lock, uint32_t key)
+{
+#if defined(STM32_HOST_SIMULATION)
+    (void)key;
+    __atomic_clear(&stm32_host_locks[lock], __ATOMIC_RELEASE);
+#else
+    (void)lock;
+    stm32_irq_restore(key);
+#endif
+}
+
+/**
+ * @brief Return the timestamp recorded for interrupt events.
+ *
+ * The DWT cycle counter, i.e. core clock cycles.  It wraps every 2^32
+ * cycles, so only differences between nearby timestamps are meaningful.
+ * The counter is started by stm32_timestamp_enable().
+ */
+static inline uint32_t stm32_timestamp(void)
+{
+    return STM32_DWT_CYCCNT;
+}
+
+/**
+ * @brief Start the DWT cycle counter used by stm32_timestamp().
+ */
+static inline void stm32_timestamp_enable(void)
+{
+    STM32_DEMCR    |= STM32_DEMCR_TRCENA;
+    STM32_DWT_LAR   = STM32_DWT_LAR_KEY;
+    STM32_DWT_CTRL |= STM32_DWT_CTRL_CYCCNTENA;
+}
 
 /**
  * @brief Handle a GPIO EXTI interrupt for the specified pending lines.
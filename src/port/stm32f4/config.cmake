@@ -1 +1,3 @@
-set(DMOD_TOOLS_NAME	"arch/armv7/cortex-m4" CACHE STRING "Name of the tools configuration")
\ No newline at end of file
+set(DMOD_TOOLS_NAME	"arch/armv7/cortex-m4" CACHE STRING "Name of the tools configuration")
+# Cortex-M4: GPIO, EXTI and SYSCFG sit in the peripheral bit-band region
+set(DMGPIO_PORT_DEFINITIONS STM32_BIT_BAND)